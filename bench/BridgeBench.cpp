@@ -0,0 +1,369 @@
+// Bridge benchmarks: StartVM latency, System.out / System.in throughput, class resolution and transition cost
+//
+//   BridgeBench <jar folder> [--classes <archive>] [--json <file>] [--min-time <seconds>] [--filter <text>]
+//
+// The jar folder must contain jni.hpp.jar and jni.hpp.bench.jar (built by CMake)
+// The archive holds classes that are not on the classpath (bench/payload.jpa), BenchVM serves them through LoadClassData
+// Results are printed as table and optionally written in the google benchmark json format (tools/compare.py works on them)
+#include <jni.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+// Vm with synthetic streams (stdout is counted and dropped, stdin never runs dry) and natively served classes
+class BenchVM : public jni::JavaVM
+{
+    public:
+        BenchVM(std::filesystem::path JarFolder) :
+            JarFolder(std::move(JarFolder))
+        {}
+
+        // Bytes received through System.out
+        uint64_t OutBytes = 0;
+        // Classes defined from LoadClassData
+        uint64_t ServedClasses = 0;
+        // Classes to serve
+        jni::ClassArchive Classes;
+
+    protected:
+        void SetupVM(jni::VMArguments& Args) override
+        {
+            Args.SetJNIVersion(JNI_VERSION_10);
+            Args.AddClasspathJarFolder(JarFolder);
+        }
+        void SystemOut(const char* Message, size_t Length) override
+        {
+            OutBytes += Length;
+        }
+        size_t SystemInRead(char* Destination, size_t Max) override
+        {
+            std::memset(Destination, 'x', Max);
+            return Max;
+        }
+        size_t SystemInAvailable() override
+        {
+            return 0x7FFFFFFF;
+        }
+        jni::MemoryBlock LoadClassData(std::string_view ClassName) override
+        {
+            std::string_view ClassBytes = Classes.FindClass(ClassName);
+            if (ClassBytes.empty())
+                return jni::MemoryBlock();
+
+            ServedClasses++;
+            return jni::MemoryBlock::Static(ClassBytes.data(), ClassBytes.size());
+        }
+
+    private:
+        std::filesystem::path JarFolder;
+};
+
+// Minimal harness (iterations grow until a run takes at least MinTime)
+class Suite
+{
+    public:
+        struct Result
+        {
+            std::string Name;
+            uint64_t Iterations = 0;
+            double Nanoseconds = 0.0;
+            double BytesPerSecond = 0.0;
+        };
+
+        Suite(double MinTime, std::string Filter) :
+            MinTime(MinTime), Filter(std::move(Filter))
+        {}
+
+        // Body(N) performs N operations, BytesPerOperation > 0 adds a throughput column
+        template<typename F>
+        void Run(const std::string& Name, uint64_t BytesPerOperation, F&& Body)
+        {
+            if (!Selected(Name))
+                return;
+
+            uint64_t Iterations = 1;
+            while (true)
+            {
+                Clock::time_point Start = Clock::now();
+                Body(Iterations);
+                double Seconds = std::chrono::duration<double>(Clock::now() - Start).count();
+                if (Seconds >= MinTime || Iterations >= (uint64_t)1 << 40)
+                {
+                    Add(Name, Iterations, Seconds, BytesPerOperation * Iterations);
+                    break;
+                }
+
+                // Aim 40% above the minimum (at most 10x per step)
+                double Factor = Seconds > 0.0 ? std::min(MinTime * 1.4 / Seconds, 10.0) : 10.0;
+                Iterations = std::max<uint64_t>(Iterations + 1, (uint64_t)((double)Iterations * Factor));
+            }
+        }
+
+        // Records a measurement that can only be taken once
+        void Add(const std::string& Name, uint64_t Iterations, double Seconds, uint64_t Bytes = 0)
+        {
+            if (!Selected(Name) || !Iterations)
+                return;
+
+            Result Entry;
+            Entry.Name = Name;
+            Entry.Iterations = Iterations;
+            Entry.Nanoseconds = Seconds * 1e9 / (double)Iterations;
+            Entry.BytesPerSecond = Bytes && Seconds > 0.0 ? (double)Bytes / Seconds : 0.0;
+            Results.push_back(Entry);
+
+            std::cout << std::left << std::setw(36) << Name << std::right << std::setw(16) << std::fixed << std::setprecision(1) << Entry.Nanoseconds << " ns" << std::setw(14) << Iterations;
+            if (Entry.BytesPerSecond > 0.0)
+            {
+                std::cout << std::setw(12) << std::setprecision(1) << Entry.BytesPerSecond / (1024.0 * 1024.0) << " MiB/s";
+            }
+            std::cout << std::endl;
+        }
+
+        bool Selected(const std::string& Name) const
+        {
+            return Filter.empty() || Name.find(Filter) != std::string::npos;
+        }
+
+        // Google benchmark compatible output
+        bool WriteJson(const std::filesystem::path& Path) const
+        {
+            std::string Json = "{\n  \"context\": {\"executable\": \"BridgeBench\", \"library\": \"jni.hpp\"},\n  \"benchmarks\": [";
+            for (size_t i = 0; i < Results.size(); i++)
+            {
+                const Result& Entry = Results[i];
+                char Values[160];
+                std::snprintf(Values, sizeof(Values), "\"iterations\": %llu, \"real_time\": %.3f, \"cpu_time\": %.3f, \"time_unit\": \"ns\"", (unsigned long long)Entry.Iterations, Entry.Nanoseconds, Entry.Nanoseconds);
+
+                Json += i ? ",\n    {" : "\n    {";
+                Json += "\"name\": \"" + Entry.Name + "\", \"run_type\": \"iteration\", " + Values;
+                if (Entry.BytesPerSecond > 0.0)
+                {
+                    std::snprintf(Values, sizeof(Values), ", \"bytes_per_second\": %.1f", Entry.BytesPerSecond);
+                    Json += Values;
+                }
+                Json += "}";
+            }
+            Json += "\n  ]\n}\n";
+
+            std::ofstream Out(Path, std::ios::binary | std::ios::trunc);
+            Out << Json;
+            return (bool)Out;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        double MinTime;
+        std::string Filter;
+        std::vector<Result> Results;
+};
+
+// C++ side of BridgeBench.Particle
+struct Particle
+{
+    double X = 0.0;
+    double Y = 0.0;
+    double Z = 0.0;
+    jint Id = 0;
+};
+
+// Target of the java --> C++ transition
+static void Noop()
+{
+}
+// Target of the java --> C++ transition with a converted argument (by value)
+static jint Length(std::string Value)
+{
+    return (jint)Value.size();
+}
+
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <jar folder> [--classes <archive>] [--json <file>] [--min-time <seconds>] [--filter <text>]" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path JsonFile;
+    std::filesystem::path ClassFile;
+    double MinTime = 0.5;
+    std::string Filter;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string Option = argv[i];
+        if (Option == "--json")
+            JsonFile = argv[i + 1];
+        else if (Option == "--classes")
+            ClassFile = argv[i + 1];
+        else if (Option == "--min-time")
+            MinTime = std::atof(argv[i + 1]);
+        else if (Option == "--filter")
+            Filter = argv[i + 1];
+    }
+
+    Suite Bench(MinTime, Filter);
+    BenchVM VM(argv[1]);
+    if (!ClassFile.empty() && !VM.Classes.Open(ClassFile))
+    {
+        std::cout << "Cannot open " << ClassFile << std::endl;
+        return 1;
+    }
+
+    // Vm startup (once per process)
+    Clock::time_point Start = Clock::now();
+    if (!VM.StartVM())
+    {
+        std::cout << "StartVM failed" << std::endl;
+        return 1;
+    }
+    Bench.Add("StartVM", 1, std::chrono::duration<double>(Clock::now() - Start).count());
+
+    ::JNIEnv* Env = VM.GetEnv();
+    const char* BenchClass = "com/fuechsl/jnihpp/bench/BridgeBench";
+    jni::NativeMethods Natives(BenchClass);
+    Natives.Add<&Noop>("NNoop");
+    Natives.Add<&Length>("NLength");
+    jni::StaticMethod<void()> JavaNoop(BenchClass, "Noop");
+    jni::StaticMethod<void(jint)> JavaBounce(BenchClass, "Bounce");
+    jni::StaticMethod<void(jint, jstring)> JavaBounceString(BenchClass, "BounceString");
+    jni::StaticMethod<void(jint, jint)> JavaPrint(BenchClass, "Print");
+    jni::StaticMethod<jlong(jlong, jint)> JavaDrain(BenchClass, "Drain");
+    jni::StaticMethod<jni::Object<"[Lcom/fuechsl/jnihpp/bench/BridgeBench$Particle;">(jint)> JavaParticles(BenchClass, "Particles");
+    if (!Natives.Register(Env) || !JavaNoop.Resolve(Env) || !JavaBounce.Resolve(Env) || !JavaBounceString.Resolve(Env) || !JavaPrint.Resolve(Env) || !JavaDrain.Resolve(Env) || !JavaParticles.Resolve(Env))
+    {
+        std::cout << "jni.hpp.bench.jar is missing in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    // Single transitions
+    Bench.Run("Transition/CppToJava", 0, [&](uint64_t Count)
+    {
+        for (uint64_t i = 0; i < Count; i++)
+        {
+            JavaNoop(Env);
+        }
+    });
+    Bench.Run("Transition/JavaToCpp", 0, [&](uint64_t Count)
+    {
+        JavaBounce(Env, (jint)std::min<uint64_t>(Count, 0x7FFFFFFF));
+    });
+    jstring JAVA_Text = jni::NewString(Env, "transition payload of 32 bytes..");
+    Bench.Run("Transition/JavaToCppString", 0, [&](uint64_t Count)
+    {
+        JavaBounceString(Env, (jint)std::min<uint64_t>(Count, 0x7FFFFFFF), JAVA_Text);
+    });
+    Env->DeleteLocalRef(JAVA_Text);
+
+    // System.out (batched by NativePrintStream)
+    for (jint Size : { 16, 256, 4096, 65536 })
+    {
+        Bench.Run("Stdout/" + std::to_string(Size), (uint64_t)Size, [&](uint64_t Count)
+        {
+            JavaPrint(Env, Size, (jint)std::min<uint64_t>(Count, 0x7FFFFFFF));
+        });
+    }
+
+    // System.in (NativeInputStream, one read call per operation)
+    for (jint Chunk : { 1, 64, 8192 })
+    {
+        Bench.Run("Stdin/" + std::to_string(Chunk), (uint64_t)Chunk, [&](uint64_t Count)
+        {
+            JavaDrain(Env, (jlong)(Count * (uint64_t)Chunk), Chunk);
+        });
+    }
+
+    // Primitive fields of an object array: one Marshaller call vs. one JNI call per field and object
+    constexpr jint ParticleCount = 1024;
+    jobjectArray JAVA_Particles = (jobjectArray)JavaParticles(Env, ParticleCount).Ref;
+    jni::StructMapping<Particle> Mapping("com/fuechsl/jnihpp/bench/BridgeBench$Particle");
+    Mapping.Add<&Particle::X>("x").Add<&Particle::Y>("y").Add<&Particle::Z>("z").Add<&Particle::Id>("id");
+    jclass JAVA_Particle = Env->FindClass("com/fuechsl/jnihpp/bench/BridgeBench$Particle");
+    if (JAVA_Particles && JAVA_Particle && Mapping.Resolve(Env))
+    {
+        std::vector<Particle> Particles(ParticleCount);
+        Bench.Run("Marshal/StructMapping/1024", ParticleCount * sizeof(Particle), [&](uint64_t Count)
+        {
+            for (uint64_t i = 0; i < Count; i++)
+            {
+                Mapping.Read(Env, JAVA_Particles, std::span<Particle>(Particles));
+            }
+        });
+
+        jfieldID X = Env->GetFieldID(JAVA_Particle, "x", "D");
+        jfieldID Y = Env->GetFieldID(JAVA_Particle, "y", "D");
+        jfieldID Z = Env->GetFieldID(JAVA_Particle, "z", "D");
+        jfieldID Id = Env->GetFieldID(JAVA_Particle, "id", "I");
+        Bench.Run("Marshal/GetField/1024", ParticleCount * sizeof(Particle), [&](uint64_t Count)
+        {
+            for (uint64_t i = 0; i < Count; i++)
+            {
+                for (jint n = 0; n < ParticleCount; n++)
+                {
+                    jobject JAVA_Object = Env->GetObjectArrayElement(JAVA_Particles, n);
+                    Particles[n].X = Env->GetDoubleField(JAVA_Object, X);
+                    Particles[n].Y = Env->GetDoubleField(JAVA_Object, Y);
+                    Particles[n].Z = Env->GetDoubleField(JAVA_Object, Z);
+                    Particles[n].Id = Env->GetIntField(JAVA_Object, Id);
+                    Env->DeleteLocalRef(JAVA_Object);
+                }
+            }
+        });
+    }
+    else
+    {
+        std::cout << "Marshal: BridgeBench.Particle cannot be mapped" << std::endl;
+    }
+    if (JAVA_Particle)
+        Env->DeleteLocalRef(JAVA_Particle);
+    if (JAVA_Particles)
+        Env->DeleteLocalRef(JAVA_Particles);
+    Env->ExceptionClear();
+
+    // Class loading through the jni-hpp loader (first lookup defines the class from LoadClassData, later lookups are cache hits)
+    std::vector<std::string> Names;
+    for (size_t i = 0; i < VM.Classes.GetEntryCount(); i++)
+    {
+        std::string_view Path = VM.Classes.GetEntryName(i);
+        if (Path.size() > 6 && Path.substr(Path.size() - 6) == ".class")
+        {
+            Names.emplace_back(Path.substr(0, Path.size() - 6));
+        }
+    }
+    if (!Names.empty() && Bench.Selected("LoadClass/Native"))
+    {
+        size_t Found = 0;
+        Start = Clock::now();
+        for (const std::string& Name : Names)
+        {
+            Found += VM.FindClass(Name) ? 1 : 0;
+        }
+        Bench.Add("LoadClass/Native", Found, std::chrono::duration<double>(Clock::now() - Start).count());
+        if (VM.ServedClasses != Names.size())
+        {
+            std::cout << "LoadClass/Native: " << VM.ServedClasses << " of " << Names.size() << " classes came from LoadClassData" << std::endl;
+        }
+    }
+    if (!Names.empty())
+    {
+        Bench.Run("LoadClass/CacheHit", 0, [&](uint64_t Count)
+        {
+            for (uint64_t i = 0; i < Count; i++)
+            {
+                VM.FindClass(Names[i % Names.size()]);
+            }
+        });
+    }
+    Env->ExceptionClear();
+
+    if (!JsonFile.empty() && !Bench.WriteJson(JsonFile))
+    {
+        std::cout << "Cannot write " << JsonFile << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Startup benchmark: time from StartVM to the first completed java call with and without a startup profile
+//
+//   StartupProfile <jar folder> <profile folder> [off|train|replay|compare] [class] [static method]
+//
+// The vm can only be created once per process, so "compare" (default) runs this executable once per mode
+// The first call is a static ()V method that StartVM does not touch (default com/fuechsl/jnihpp/bench/StartupApp.Run)
+#include <jni.hpp>
+
+#include <chrono>
+#include <cstdlib>
+
+// Minimal vm that puts all jars of a folder on the classpath
+class BenchVM : public jni::JavaVM
+{
+    public:
+        BenchVM(std::filesystem::path JarFolder) :
+            JarFolder(std::move(JarFolder))
+        {}
+
+    protected:
+        void SetupVM(jni::VMArguments& Args) override
+        {
+            Args.SetJNIVersion(JNI_VERSION_10);
+            Args.AddClasspathJarFolder(JarFolder);
+        }
+
+    private:
+        std::filesystem::path JarFolder;
+};
+
+// Starts the vm in one mode and prints the time to the first call (milliseconds, -1 on failure)
+static int RunMode(const std::string& Mode, const std::filesystem::path& JarFolder, const std::filesystem::path& ProfileFolder, const std::string& ClassName, const std::string& MethodName)
+{
+    using Clock = std::chrono::steady_clock;
+
+    BenchVM VM(JarFolder);
+    if (Mode == "train")
+    {
+        VM.SetStartupProfile(ProfileFolder, jni::StartupProfileMode::Train);
+    }
+    else if (Mode == "replay")
+    {
+        VM.SetStartupProfile(ProfileFolder, jni::StartupProfileMode::Replay);
+    }
+
+    // Time to first call
+    Clock::time_point Start = Clock::now();
+    double Milliseconds = -1.0;
+    if (VM.StartVM())
+    {
+        jni::StaticMethod<void()> FirstCall(ClassName.c_str(), MethodName.c_str());
+        if (FirstCall.Resolve(VM.GetEnv()))
+        {
+            FirstCall(VM.GetEnv());
+            Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        }
+
+        // Replay time is part of the startup cost too
+        VM.WaitForStartupProfile();
+        double Total = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        std::cout << Mode << ": time-to-first-call " << Milliseconds << " ms (replay done after " << Total << " ms)" << std::endl;
+    }
+    else
+    {
+        std::cout << Mode << ": StartVM failed" << std::endl;
+    }
+
+    return Milliseconds >= 0.0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: " << argv[0] << " <jar folder> <profile folder> [off|train|replay|compare] [class] [static method]" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path JarFolder = argv[1];
+    std::filesystem::path ProfileFolder = argv[2];
+    std::string Mode = argc > 3 ? argv[3] : "compare";
+    std::string ClassName = argc > 4 ? argv[4] : "com/fuechsl/jnihpp/bench/StartupApp";
+    std::string MethodName = argc > 5 ? argv[5] : "Run";
+
+    if (Mode != "compare")
+    {
+        return RunMode(Mode, JarFolder, ProfileFolder, ClassName, MethodName);
+    }
+
+    // One process per mode (cold profile first, then training, then the profiled run)
+    int Result = 0;
+    for (const char* Run : { "off", "train", "replay" })
+    {
+        std::string Command = "\"" + std::string(argv[0]) + "\" \"" + JarFolder.string() + "\" \"" + ProfileFolder.string() + "\" " + Run + " \"" + ClassName + "\" \"" + MethodName + "\"";
+        Result |= std::system(Command.c_str());
+    }
+    return Result ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+package com.fuechsl.jnihpp.bench;
+
+import java.io.IOException;
+import java.io.InputStream;
+
+/***
+ * Java side of the bridge benchmarks (called from bench/BridgeBench.cpp)
+ * @author Ludwig Fuechsl
+ */
+public final class BridgeBench {
+	// Keeps the JIT from removing the loops
+	private static volatile long sink = 0;
+	
+	/***
+	 * Object with primitive fields (marshalling benchmark)
+	 */
+	public static final class Particle {
+		public double x;
+		public double y;
+		public double z;
+		public int id;
+	}
+	
+	/***
+	 * Empty method (C++ --> java transition)
+	 */
+	public static void Noop() {
+	}
+	
+	/***
+	 * Calls the empty native method count times (java --> C++ transition)
+	 * @param count Number of calls
+	 */
+	public static void Bounce(int count) {
+		for(int i = 0; i < count; i++) {
+			NNoop();
+		}
+	}
+	
+	/***
+	 * Passes a string count times to a native method (java --> C++ transition with a converted argument)
+	 * @param count Number of calls
+	 * @param value String argument
+	 */
+	public static void BounceString(int count, String value) {
+		long sum = 0;
+		for(int i = 0; i < count; i++) {
+			sum += NLength(value);
+		}
+		sink = sum;
+	}
+	
+	/***
+	 * Writes count messages of size bytes to System.out and flushes
+	 * @param size Message size (the last byte is a newline)
+	 * @param count Number of messages
+	 */
+	public static void Print(int size, int count) {
+		byte[] message = new byte[size];
+		for(int i = 0; i < size; i++) {
+			message[i] = (byte)('a' + i % 26);
+		}
+		if(size > 0) {
+			message[size - 1] = '\n';
+		}
+		
+		for(int i = 0; i < count; i++) {
+			System.out.write(message, 0, size);
+		}
+		System.out.flush();
+	}
+	
+	/***
+	 * Reads total bytes from System.in in chunks (chunk 1 uses read())
+	 * @param total Number of bytes
+	 * @param chunk Bytes per read call
+	 * @return Number of bytes read (less on EOF)
+	 */
+	public static long Drain(long total, int chunk) throws IOException {
+		InputStream in = System.in;
+		byte[] buffer = new byte[Math.max(chunk, 1)];
+		long read = 0;
+		long sum = 0;
+		while(read < total) {
+			if(chunk <= 1) {
+				int value = in.read();
+				if(value < 0)
+					break;
+				sum += value;
+				read++;
+			}
+			else {
+				int count = in.read(buffer, 0, (int)Math.min(buffer.length, total - read));
+				if(count < 0)
+					break;
+				sum += buffer[0];
+				read += count;
+			}
+		}
+		sink = sum;
+		return read;
+	}
+	
+	/***
+	 * Creates objects for the marshalling benchmark
+	 * @param count Number of objects
+	 * @return Particles with distinct values
+	 */
+	public static Particle[] Particles(int count) {
+		Particle[] particles = new Particle[count];
+		for(int i = 0; i < count; i++) {
+			Particle particle = new Particle();
+			particle.x = i;
+			particle.y = i * 0.5;
+			particle.z = -i;
+			particle.id = i;
+			particles[i] = particle;
+		}
+		return particles;
+	}
+	
+	/***
+	 * Empty native method (registered by the benchmark)
+	 */
+	private static native void NNoop();
+	
+	/***
+	 * Length of a string (registered by the benchmark, takes std::string by value)
+	 */
+	private static native int NLength(String value);
+}
@@ -0,0 +1,65 @@
+package com.fuechsl.jnihpp.bench;
+
+import java.nio.charset.StandardCharsets;
+import java.time.Duration;
+import java.time.Instant;
+import java.time.LocalDate;
+import java.time.format.DateTimeFormatter;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Optional;
+import java.util.TreeMap;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+import java.util.stream.Collectors;
+
+/***
+ * First call of the startup benchmark (bench/StartupProfile.cpp)
+ * Touches the class graph of a typical application start that StartVM itself never loads
+ * @author Ludwig Fuechsl
+ */
+public final class StartupApp {
+	// Keeps the JIT from removing the work
+	private static volatile Object sink = null;
+	
+	/***
+	 * Parses a small configuration, formats dates, runs a stream pipeline and a future
+	 */
+	public static void Run() {
+		// Configuration parsing (regex, collections)
+		String config = "name = startup\nthreads = 4\ntimeout = PT2.5S\nstart = 2024-01-31\n# comment\n";
+		Pattern line = Pattern.compile("^\\s*([a-z]+)\\s*=\\s*(\\S+)\\s*$", Pattern.MULTILINE);
+		Map<String, String> values = new TreeMap<>();
+		Matcher matcher = line.matcher(config);
+		while(matcher.find()) {
+			values.put(matcher.group(1), matcher.group(2));
+		}
+		
+		// Typed values (java.time, boxing)
+		int threads = Integer.parseInt(values.getOrDefault("threads", "1"));
+		Duration timeout = Duration.parse(values.getOrDefault("timeout", "PT1S"));
+		LocalDate start = LocalDate.parse(values.getOrDefault("start", "2000-01-01"));
+		String stamp = DateTimeFormatter.ISO_INSTANT.format(Instant.ofEpochSecond(start.toEpochDay() * 86400L));
+		
+		// Stream pipeline and lambdas
+		List<String> words = new ArrayList<>(values.keySet());
+		Map<Integer, List<String>> byLength = words.stream().collect(Collectors.groupingBy(String::length));
+		String joined = words.stream().map(word -> word.toUpperCase()).sorted().collect(Collectors.joining(","));
+		
+		// Concurrency
+		Map<String, Integer> counts = new ConcurrentHashMap<>();
+		CompletableFuture<Integer> future = CompletableFuture.supplyAsync(() -> joined.getBytes(StandardCharsets.UTF_8).length);
+		counts.put("bytes", future.join());
+		
+		// Formatting
+		Map<String, Object> result = new HashMap<>();
+		result.put("summary", String.format("%s threads=%d timeout=%dms start=%s", values.get("name"), threads, timeout.toMillis(), stamp));
+		result.put("groups", byLength);
+		result.put("counts", counts);
+		sink = Optional.of(result);
+	}
+}
@@ -30,24 +30,81 @@
 #include <jni.h>
 
 #include <utility>
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <iostream>
-#include <array>
 #include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <deque>
+#include <span>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fstream>
+#include <thread>
+#include <unordered_set>
+#include <unordered_map>
+#include <iterator>
+#include <functional>
+#include <future>
+#include <optional>
+#include <exception>
+#include <stdexcept>
+#include <coroutine>
+#include <chrono>
+#include <bit>
 
-#ifndef JNIHPP_OPTIONS_MAX 
-#define JNIHPP_OPTIONS_MAX 32
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Classpath length (characters) above which a manifest only pathing jar is used
+#ifndef JNIHPP_CLASSPATH_MAX
+#define JNIHPP_CLASSPATH_MAX 32768
 #endif
 
 #define __JNIHPP_JNI_LOAD_AND_CHECK(val, expr) {val = expr; if(!val) return false; }
 #define __JNIHPP_JNI_CHECK_RESULT(expr) {if(expr != JNI_OK) { return false; }}
 
+// Instrumentation probes (compiled out unless JNIHPP_INSTRUMENTATION is 1, see jni::Instrumentation)
+#ifndef JNIHPP_INSTRUMENTATION
+#define JNIHPP_INSTRUMENTATION 0
+#endif
+#if JNIHPP_INSTRUMENTATION
+#define __JNIHPP_PROBE(var, probe) ::jni::ProbeScope var(::jni::Probe::probe)
+#define __JNIHPP_PROBE_BYTES(var, bytes) {var.Bytes = (uint64_t)(bytes); }
+#define __JNIHPP_PROBE_HIT(var, hit) {var.Hit = (hit) ? 1 : -1; }
+#define __JNIHPP_PROBE_LABEL(var, label) {var.SetLabel(label); }
+#else
+#define __JNIHPP_PROBE(var, probe)
+#define __JNIHPP_PROBE_BYTES(var, bytes)
+#define __JNIHPP_PROBE_HIT(var, hit)
+#define __JNIHPP_PROBE_LABEL(var, label)
+#endif
+
 // Put all in the jni namespace
 namespace jni
 {
-    // VM Startup arguments
+    // VM Startup arguments (no option limit, strings are stored stable until the vm was created)
     class VMArguments
     {
         public:
@@ -55,10 +112,12 @@ namespace jni
             VMArguments()
             {
                 JvmArgs.version = 0;
-                JvmArgs.options = &Options[0];
+                JvmArgs.options = nullptr;
                 JvmArgs.nOptions = 0;
                 JvmArgs.ignoreUnrecognized = false;
             }
+            VMArguments(const VMArguments&) = delete;
+            VMArguments& operator=(const VMArguments&) = delete;
 
             // Set the JNI version
             void SetJNIVersion(jint version) noexcept
@@ -71,28 +130,91 @@ namespace jni
                 JvmArgs.ignoreUnrecognized = ignore;
             }
 
-            // Searches a folder for all jar files and addes them to the classpath
-            void AddClasspathJarFolder(std::filesystem::path PathToFolder)
+            // Configures the System.out / System.err batching (bytes buffered before C++ is called)
+            bool SetStdStreamBuffer(size_t Capacity, bool FlushOnNewline = true)
+            {
+                return
+                    AddOption("-Djnihpp.stream.buffer=" + std::to_string(Capacity)) &&
+                    AddOption(std::string("-Djnihpp.stream.lineflush=") + (FlushOnNewline ? "true" : "false"));
+            }
+
+            // Startup profile options: class load log in training runs and a CDS archive in Directory
+            // CDS is only used when the vm supports -XX:+AutoCreateSharedArchive (JDK 19+, detected through the JNI version)
+            bool AddStartupProfile(const std::filesystem::path& Directory, bool Train)
+            {
+                bool Ok = true;
+                if (Train)
+                {
+                    Ok = AddOption("-Xlog:class+load=info:file=\"" + (Directory / "classes.log").string() + "\":none");
+                }
+                if (Ok && SupportsJNIVersion(0x00130000))
+                {
+                    Ok =
+                        AddOption("-XX:SharedArchiveFile=" + (Directory / "jnihpp.jsa").string()) &&
+                        AddOption("-XX:+AutoCreateSharedArchive");
+                }
+                return Ok;
+            }
+
+            // Checks if the linked vm supports a JNI version (JNI_VERSION_10 = 0x000a0000, JNI_VERSION_19 = 0x00130000, ...)
+            static bool SupportsJNIVersion(jint Version) noexcept
+            {
+                JavaVMInitArgs Args = {};
+                Args.version = Version;
+                return JNI_GetDefaultJavaVMInitArgs(&Args) == JNI_OK;
+            }
+
+            // Searches a folder for all jar files and addes them to the classpath (sorted by path, optionally recursive)
+            void AddClasspathJarFolder(std::filesystem::path PathToFolder, bool Recursive = false)
             {
-                // For all files
-                for (
-                    auto it = std::filesystem::directory_iterator(PathToFolder);
-                    it != std::filesystem::directory_iterator();
-                    ++it
-                    )
+                std::vector<std::filesystem::path> Jars;
+                std::error_code Error;
+                auto Collect = [&Jars](const std::filesystem::directory_entry& Entry)
                 {
-                    // Check extension
-                    if (it->path().extension() == std::string(".jar"))
+                    if (Entry.path().extension() == std::string(".jar") && Entry.is_regular_file())
                     {
-                        AddClasspathJar(it->path());
+                        Jars.push_back(Entry.path());
                     }
+                };
+                if (Recursive)
+                {
+                    for (auto it = std::filesystem::recursive_directory_iterator(PathToFolder, Error); !Error && it != std::filesystem::recursive_directory_iterator(); it.increment(Error))
+                        Collect(*it);
+                }
+                else
+                {
+                    for (auto it = std::filesystem::directory_iterator(PathToFolder, Error); !Error && it != std::filesystem::directory_iterator(); it.increment(Error))
+                        Collect(*it);
+                }
+
+                // Directory order is file system dependent
+                std::sort(Jars.begin(), Jars.end());
+                for (const std::filesystem::path& Jar : Jars)
+                {
+                    AddClasspathJar(Jar);
                 }
             }
 
-            // Adds a SINGLE jar to the classpath
+            // Adds a SINGLE jar (or class folder) to the classpath (duplicates are ignored)
             void AddClasspathJar(std::filesystem::path PathToJar)
             {
-                JarFiles.push_back(PathToJar.generic_string());
+                std::string Entry = PathToJar.lexically_normal().generic_string();
+                if (ClassPathSet.insert(Entry).second)
+                {
+                    ClassPath.push_back(std::move(Entry));
+                    ClassPathLength += ClassPath.back().size() + 1;
+                    Dirty = true;
+                }
+            }
+
+            // Classpaths longer than Threshold characters are moved into a manifest only "pathing jar" in Directory
+            // (one short jar entry instead of a huge option string, the jar is reused while the classpath is unchanged)
+            // A Threshold of 0 disables the fallback
+            void SetPathingJar(std::filesystem::path Directory, size_t Threshold = JNIHPP_CLASSPATH_MAX)
+            {
+                PathingJarDirectory = std::move(Directory);
+                PathingJarThreshold = Threshold;
+                Dirty = true;
             }
 
             // Add option helpers
@@ -108,214 +230,5572 @@ namespace jni
             // Add option
             bool AddOption(const char* option, const char* extraInfo = nullptr)
             {
-                // Check if adding is possible
-                bool CanAdd = AvailibleOptions;
-                if (CanAdd)
+                JavaVMOption Option;
+                Option.optionString = option ? Store(option) : nullptr;
+                Option.extraInfo = extraInfo ? (void*)Store(extraInfo) : nullptr;
+                Options.push_back(Option);
+                Dirty = true;
+                return true;
+            }
+
+            // Retrive reference to args (classpath is built once per change)
+            const JavaVMInitArgs& Get()
+            {
+                if (Dirty)
                 {
-                    // Store string
-                    if (option)
+                    Final = Options;
+                    if (!ClassPath.empty())
                     {
-                        StringBuffer.push_back(option);
-                        Options[JNIHPP_OPTIONS_MAX - AvailibleOptions].optionString = &StringBuffer[StringBuffer.size() - 1][0];
+                        JavaVMOption Option;
+                        Option.optionString = Store(BuildClassPathOption());
+                        Option.extraInfo = nullptr;
+                        Final.push_back(Option);
                     }
-                    else
+                    Dirty = false;
+                }
+
+                // Return args
+                JvmArgs.options = Final.data();
+                JvmArgs.nOptions = (jint)Final.size();
+                return JvmArgs;
+            }
+
+            // Platform classpath separator
+            static constexpr char ClassPathSeparator() noexcept
+            {
+            #if defined(_WIN32)
+                return ';';
+            #else
+                return ':';
+            #endif
+            }
+
+        private:
+            // Copies a string into the stable storage
+            char* Store(std::string_view Value)
+            {
+                Strings.emplace_back(Value);
+                return Strings.back().data();
+            }
+
+            // "-Djava.class.path=..." (or the pathing jar when too long)
+            std::string BuildClassPathOption()
+            {
+                std::string Option = "-Djava.class.path=";
+                if (PathingJarThreshold && ClassPathLength > PathingJarThreshold)
+                {
+                    std::filesystem::path Jar = WritePathingJar();
+                    if (!Jar.empty())
+                    {
+                        return Option + Jar.string();
+                    }
+                }
+
+                Option.reserve(Option.size() + ClassPathLength);
+                for (size_t i = 0; i < ClassPath.size(); i++)
+                {
+                    if (i)
+                        Option += ClassPathSeparator();
+                    Option += ClassPath[i];
+                }
+                return Option;
+            }
+
+            // Writes (or reuses) the pathing jar, returns its path or an empty path on failure
+            std::filesystem::path WritePathingJar()
+            {
+                // Manifest (absolute file URLs, folders need a trailing slash, lines are wrapped at 72 bytes)
+                std::string ClassPathValue;
+                for (const std::string& Entry : ClassPath)
+                {
+                    std::error_code Error;
+                    std::filesystem::path Absolute = std::filesystem::absolute(Entry, Error);
+                    std::string Url = "file:" + std::string(Absolute.generic_string().starts_with("/") ? "" : "/") + UrlEncode(Absolute.generic_string());
+                    if (std::filesystem::is_directory(Absolute, Error) && !Url.ends_with("/"))
+                        Url += '/';
+                    if (!ClassPathValue.empty())
+                        ClassPathValue += ' ';
+                    ClassPathValue += Url;
+                }
+                std::string Manifest = "Manifest-Version: 1.0\r\n" + WrapManifestLine("Class-Path: " + ClassPathValue) + "Created-By: jni-hpp\r\n\r\n";
+
+                // Name depends on the content: an unchanged classpath reuses the jar of an earlier run
+                uint64_t Hash = 0xcbf29ce484222325ull;
+                for (char c : Manifest)
+                {
+                    Hash = (Hash ^ (unsigned char)c) * 0x100000001b3ull;
+                }
+                char Name[32];
+                std::snprintf(Name, sizeof(Name), "jnihpp-%016llx.jar", (unsigned long long)Hash);
+
+                std::error_code Error;
+                std::filesystem::path Directory = PathingJarDirectory.empty() ? std::filesystem::temp_directory_path(Error) : PathingJarDirectory;
+                std::filesystem::create_directories(Directory, Error);
+                std::filesystem::path Jar = Directory / Name;
+                if (std::filesystem::exists(Jar, Error))
+                {
+                    return Jar;
+                }
+
+                // Write to a temporary file and move it in place (concurrent starts never see half a jar)
+                std::filesystem::path Temporary = Jar;
+                Temporary += "." + std::to_string((unsigned long long)(uintptr_t)this) + ".tmp";
+                {
+                    std::ofstream Stream(Temporary, std::ios::binary | std::ios::trunc);
+                    if (!Stream)
+                    {
+                        return {};
+                    }
+                    WriteStoredZip(Stream, "META-INF/MANIFEST.MF", Manifest);
+                    if (!Stream)
                     {
-                        Options[JNIHPP_OPTIONS_MAX - AvailibleOptions].optionString = nullptr;
+                        return {};
                     }
-                    if (extraInfo)
+                }
+                std::filesystem::rename(Temporary, Jar, Error);
+                if (Error)
+                {
+                    std::filesystem::remove(Temporary, Error);
+                    return std::filesystem::exists(Jar, Error) ? Jar : std::filesystem::path();
+                }
+                return Jar;
+            }
+
+            // Percent encoding of everything but unreserved characters, '/' and ':'
+            static std::string UrlEncode(const std::string& Path)
+            {
+                static constexpr char Hex[] = "0123456789ABCDEF";
+                std::string Encoded;
+                Encoded.reserve(Path.size());
+                for (unsigned char c : Path)
+                {
+                    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || std::strchr("-._~/:", c))
                     {
-                        StringBuffer.push_back(extraInfo);
-                        Options[JNIHPP_OPTIONS_MAX - AvailibleOptions].extraInfo = &StringBuffer[StringBuffer.size() - 1][0];
+                        Encoded += (char)c;
                     }
                     else
                     {
-                        Options[JNIHPP_OPTIONS_MAX - AvailibleOptions].extraInfo = nullptr;
+                        Encoded += '%';
+                        Encoded += Hex[c >> 4];
+                        Encoded += Hex[c & 15];
                     }
-                    // One options less
-                    AvailibleOptions--;
                 }
+                return Encoded;
+            }
 
-                return CanAdd;
+            // Manifest lines have at most 72 bytes, continuation lines start with a space
+            static std::string WrapManifestLine(const std::string& Line)
+            {
+                std::string Wrapped;
+                size_t Offset = 0;
+                size_t Width = 72;
+                while (Offset < Line.size())
+                {
+                    if (Offset)
+                        Wrapped += ' ';
+                    Wrapped.append(Line, Offset, Width);
+                    Wrapped += "\r\n";
+                    Offset += Width;
+                    Width = 71;
+                }
+                return Wrapped;
             }
 
-            // Retrive reference to args
-            const JavaVMInitArgs& Get() noexcept
+            // Single file zip without compression
+            static void WriteStoredZip(std::ostream& Stream, const std::string& FileName, const std::string& Content)
             {
-                // Adopt class path
-                std::string ClassPath = "-Djava.class.path=";
-                for (auto it = JarFiles.begin(); it != JarFiles.end(); it++)
+                // CRC-32 (IEEE)
+                uint32_t Crc = 0xFFFFFFFFu;
+                for (unsigned char c : Content)
                 {
-                    ClassPath += *it + ";";
+                    Crc ^= c;
+                    for (int Bit = 0; Bit < 8; Bit++)
+                    {
+                        Crc = (Crc >> 1) ^ (0xEDB88320u & (0u - (Crc & 1u)));
+                    }
                 }
-                AddOption(ClassPath);
+                Crc ^= 0xFFFFFFFFu;
 
-                // Evaluate options count
-                JvmArgs.nOptions = JNIHPP_OPTIONS_MAX - AvailibleOptions;
+                auto U16 = [&Stream](uint16_t Value) { char Bytes[2] = { (char)(Value & 0xFF), (char)(Value >> 8) }; Stream.write(Bytes, 2); };
+                auto U32 = [&U16](uint32_t Value) { U16((uint16_t)(Value & 0xFFFF)); U16((uint16_t)(Value >> 16)); };
+                uint32_t Size = (uint32_t)Content.size();
+                uint16_t NameSize = (uint16_t)FileName.size();
 
-                // Return args
-                return JvmArgs;
+                // Local file header + data
+                U32(0x04034b50); U16(10); U16(0); U16(0); U16(0); U16(0x21);
+                U32(Crc); U32(Size); U32(Size); U16(NameSize); U16(0);
+                Stream.write(FileName.data(), NameSize);
+                Stream.write(Content.data(), Size);
+
+                // Central directory
+                uint32_t DirectoryOffset = 30 + NameSize + Size;
+                U32(0x02014b50); U16(20); U16(10); U16(0); U16(0); U16(0); U16(0x21);
+                U32(Crc); U32(Size); U32(Size); U16(NameSize); U16(0); U16(0); U16(0); U16(0); U32(0); U32(0);
+                Stream.write(FileName.data(), NameSize);
+
+                // End of central directory
+                U32(0x06054b50); U16(0); U16(0); U16(1); U16(1);
+                U32(46 + NameSize); U32(DirectoryOffset); U16(0);
             }
+
         private:
             // Java VM Args
             JavaVMInitArgs JvmArgs;
 
-            // Classpath
-            std::vector<std::string> JarFiles;
+            // Stable string storage (deque elements never move)
+            std::deque<std::string> Strings;
 
-            // Buffering vector
-            std::vector<std::string> StringBuffer;
+            // Java options (Final = Options + classpath, rebuilt when Dirty)
+            std::vector<JavaVMOption> Options;
+            std::vector<JavaVMOption> Final;
+            bool Dirty = true;
 
-            // Java options
-            std::array<JavaVMOption, JNIHPP_OPTIONS_MAX> Options;
-            size_t AvailibleOptions = JNIHPP_OPTIONS_MAX;
+            // Classpath (insertion order, deduplicated)
+            std::vector<std::string> ClassPath;
+            std::unordered_set<std::string> ClassPathSet;
+            size_t ClassPathLength = 0;
+
+            // Pathing jar fallback
+            std::filesystem::path PathingJarDirectory;
+            size_t PathingJarThreshold = JNIHPP_CLASSPATH_MAX;
     };
 
-    // Relevant java class, function, field, ... table
-    struct JAVA_Table
+    // Native memory that is handed to java without copying (Release is invoked once java is done with it)
+    class MemoryBlock
     {
-        jclass JAVA_Cls_NativClassLoadResult = nullptr;
-        jfieldID JAVA_Fld_NativClassLoadResult_Loaded = nullptr;
-        jfieldID JAVA_Fld_NativClassLoadResult_Data = nullptr;
+        public:
+            // Callback that frees / unpins the memory
+            using ReleaseFunction = void(*)(const void* Data, size_t Size, void* Context);
 
-        jclass JAVA_Cls_ClassLoader = nullptr;
-        jfieldID JAVA_Fld_ClassLoader_InstanceId = nullptr;
+            // Construct
+            MemoryBlock() noexcept = default;
+            MemoryBlock(const void* Data, size_t Size, ReleaseFunction Release = nullptr, void* Context = nullptr) noexcept :
+                Data(Data), Size(Size), Release(Release), Context(Context)
+            {}
+            MemoryBlock(const MemoryBlock&) = delete;
+            MemoryBlock(MemoryBlock&& Other) noexcept
+            {
+                *this = std::move(Other);
+            }
 
-        jclass JAVA_Cls_Setup = nullptr;
-        jmethodID JAVA_Mth_Setup_RunSetup = nullptr;
+            // Assign
+            MemoryBlock& operator=(const MemoryBlock&) = delete;
+            MemoryBlock& operator=(MemoryBlock&& Other) noexcept
+            {
+                if (&Other != this)
+                {
+                    Reset();
+                    std::swap(Data, Other.Data);
+                    std::swap(Size, Other.Size);
+                    std::swap(Release, Other.Release);
+                    std::swap(Context, Other.Context);
+                }
+                return *this;
+            }
 
-        jclass JAVA_Cls_NativePrintStream = nullptr;
+            // Destruct
+            ~MemoryBlock()
+            {
+                Reset();
+            }
 
-        jclass JAVA_Cls_NativeInputStream = nullptr;
+            // Memory that outlives the VM (static data, mappings, arenas): nothing is released
+            static MemoryBlock Static(const void* Data, size_t Size) noexcept
+            {
+                return MemoryBlock(Data, Size);
+            }
+            // Memory allocated with new char[...]
+            static MemoryBlock FromNewArray(char* Data, size_t Size) noexcept
+            {
+                return MemoryBlock(Data, Size, [](const void* Data, size_t, void*) { delete[] (char*)Data; });
+            }
+
+            // Release the memory now
+            void Reset() noexcept
+            {
+                if (Release)
+                {
+                    Release(Data, Size, Context);
+                }
+                Data = nullptr;
+                Size = 0;
+                Release = nullptr;
+                Context = nullptr;
+            }
+
+            // Access
+            const void* GetData() const noexcept
+            {
+                return Data;
+            }
+            size_t GetSize() const noexcept
+            {
+                return Size;
+            }
+            bool IsStatic() const noexcept
+            {
+                return Release == nullptr;
+            }
+            explicit operator bool() const noexcept
+            {
+                return Data && Size;
+            }
+
+        private:
+            // Memory
+            const void* Data = nullptr;
+            size_t Size = 0;
+
+            // Owner
+            ReleaseFunction Release = nullptr;
+            void* Context = nullptr;
     };
 
-    // Class that interfaces with JNI (override this class)
-    class JavaVM
+    // Read only, memory mapped archive of classes and resources (created with com.fuechsl.jnihpp.tools.ArchivePacker)
+    // Layout (little endian):
+    //   Header  { char Magic[8] = "JNIHPPAR"; u32 Version; u32 EntryCount; u64 EntryOffset; u64 Reserved; }
+    //   Entries { u64 Hash; u64 NameOffset; u64 DataOffset; u32 NameSize; u32 DataSize; } sorted by Hash
+    //   Names and data blobs (8 byte aligned)
+    // Hash is the 64 bit FNV-1a of the resource path ("com/foo/Bar.class")
+    class ClassArchive
     {
         public:
             // Construct
-            JavaVM() noexcept = default;
-            JavaVM(const JavaVM&) noexcept = delete;
-            JavaVM(JavaVM&& Other) noexcept
+            ClassArchive() noexcept = default;
+            ClassArchive(const ClassArchive&) = delete;
+            ClassArchive(ClassArchive&& Other) noexcept
             {
-                // Do a assign operation
                 *this = std::move(Other);
             }
 
             // Assign
-            JavaVM& operator=(const JavaVM&) noexcept = delete;
-            JavaVM& operator=(JavaVM&& Other) noexcept
+            ClassArchive& operator=(const ClassArchive&) = delete;
+            ClassArchive& operator=(ClassArchive&& Other) noexcept
             {
-                // Prevent self move
                 if (&Other != this)
                 {
-                    // Move and unset critical
-                    JVM = Other.JVM;
-                    JNIEnv = Other.JNIEnv;
-                    Other.JVM = nullptr;
-                    Other.JNIEnv = nullptr;
+                    Close();
+                    std::swap(Mapping, Other.Mapping);
+                    std::swap(MappingSize, Other.MappingSize);
+                    std::swap(Entries, Other.Entries);
+                    std::swap(EntryCount, Other.EntryCount);
+                    std::swap(Table, Other.Table);
+                }
+                return *this;
+            }
 
-                    // Copy jvt
-                    jvt = Other.jvt;
+            // Destruct
+            ~ClassArchive()
+            {
+                Close();
+            }
+
+            // Maps the archive and builds the lookup table (Returns true on success)
+            bool Open(const std::filesystem::path& Path)
+            {
+                Close();
+                if (!Map(Path) || !BuildIndex())
+                {
+                    Close();
+                    return false;
                 }
+                return true;
             }
 
-            // Virtual destruct
-            virtual ~JavaVM()
+            // Unmaps the archive (all memory handed out before becomes invalid)
+            void Close() noexcept
             {
-                StopVM();
+                if (Mapping)
+                {
+                    #if defined(_WIN32)
+                    UnmapViewOfFile(Mapping);
+                    #else
+                    munmap((void*)Mapping, MappingSize);
+                    #endif
+                }
+                Mapping = nullptr;
+                MappingSize = 0;
+                Entries = nullptr;
+                EntryCount = 0;
+                Table.clear();
+            }
+
+            // Lookup by resource path ("com/foo/bar.txt")
+            std::string_view FindResource(std::string_view Path) const noexcept
+            {
+                return Find(Path, false);
+            }
+            // Lookup by binary class name ("com.foo.Bar")
+            std::string_view FindClass(std::string_view ClassName) const noexcept
+            {
+                return Find(ClassName, true);
+            }
+
+            // Number of entries
+            size_t GetEntryCount() const noexcept
+            {
+                return EntryCount;
+            }
+            // Resource path of entry
+            std::string_view GetEntryName(size_t Index) const noexcept
+            {
+                return Index < EntryCount ? std::string_view(Mapping + Entries[Index].NameOffset, Entries[Index].NameSize) : std::string_view();
+            }
+
+            // Check if the archive is usable
+            bool IsOpen() const noexcept
+            {
+                return Mapping != nullptr;
+            }
+
+            // 64 bit FNV-1a
+            static constexpr uint64_t HashInit = 0xcbf29ce484222325ull;
+            static constexpr uint64_t HashStep(uint64_t Hash, unsigned char Byte) noexcept
+            {
+                return (Hash ^ Byte) * 0x100000001b3ull;
+            }
+
+        private:
+            // On disk entry
+            struct Entry
+            {
+                uint64_t Hash;
+                uint64_t NameOffset;
+                uint64_t DataOffset;
+                uint32_t NameSize;
+                uint32_t DataSize;
+            };
+            static_assert(sizeof(Entry) == 32, "Archive entry layout");
+
+            // Maps the whole file read only
+            bool Map(const std::filesystem::path& Path)
+            {
+                #if defined(_WIN32)
+                HANDLE File = CreateFileW(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (File == INVALID_HANDLE_VALUE)
+                    return false;
+
+                LARGE_INTEGER FileSize;
+                HANDLE FileMapping = nullptr;
+                if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0)
+                {
+                    FileMapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                }
+                if (FileMapping)
+                {
+                    Mapping = (const char*)MapViewOfFile(FileMapping, FILE_MAP_READ, 0, 0, 0);
+                    MappingSize = Mapping ? (size_t)FileSize.QuadPart : 0;
+                    CloseHandle(FileMapping);
+                }
+                CloseHandle(File);
+                #else
+                int File = open(Path.c_str(), O_RDONLY);
+                if (File < 0)
+                    return false;
+
+                struct stat FileStat;
+                if (fstat(File, &FileStat) == 0 && FileStat.st_size > 0)
+                {
+                    void* View = mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+                    if (View != MAP_FAILED)
+                    {
+                        Mapping = (const char*)View;
+                        MappingSize = (size_t)FileStat.st_size;
+                    }
+                }
+                close(File);
+                #endif
+
+                return Mapping != nullptr;
+            }
+
+            // Validates the header / entries and builds the open addressing table
+            bool BuildIndex()
+            {
+                // Header
+                char Magic[8];
+                uint32_t Version = 0, Count = 0;
+                uint64_t EntryOffset = 0;
+                if (MappingSize < 32)
+                    return false;
+                std::memcpy(Magic, Mapping, 8);
+                std::memcpy(&Version, Mapping + 8, 4);
+                std::memcpy(&Count, Mapping + 12, 4);
+                std::memcpy(&EntryOffset, Mapping + 16, 8);
+                if (std::memcmp(Magic, "JNIHPPAR", 8) != 0 || Version != 1 || EntryOffset % 8 != 0 ||
+                    EntryOffset > MappingSize || (MappingSize - EntryOffset) / sizeof(Entry) < Count)
+                    return false;
+
+                // Entries (bounds check once, lookups trust the table afterwards)
+                Entries = (const Entry*)(Mapping + EntryOffset);
+                EntryCount = Count;
+                for (size_t i = 0; i < EntryCount; i++)
+                {
+                    const Entry& Current = Entries[i];
+                    if (Current.NameOffset > MappingSize || MappingSize - Current.NameOffset < Current.NameSize ||
+                        Current.DataOffset > MappingSize || MappingSize - Current.DataOffset < Current.DataSize)
+                        return false;
+                }
+
+                // Power of two table with at most 50% load
+                size_t TableSize = 16;
+                while (TableSize < EntryCount * 2)
+                    TableSize <<= 1;
+                Table.assign(TableSize, UINT32_MAX);
+                for (uint32_t i = 0; i < Count; i++)
+                {
+                    size_t Slot = (size_t)Entries[i].Hash & (TableSize - 1);
+                    while (Table[Slot] != UINT32_MAX)
+                        Slot = (Slot + 1) & (TableSize - 1);
+                    Table[Slot] = i;
+                }
+
+                return true;
+            }
+
+            // Hashes / compares Name as path, class names are converted on the fly ('.' -> '/' and ".class" appended)
+            std::string_view Find(std::string_view Name, bool IsClass) const noexcept
+            {
+                if (Table.empty())
+                    return {};
+
+                // Hash
+                constexpr std::string_view ClassSuffix = ".class";
+                uint64_t Hash = HashInit;
+                for (char c : Name)
+                    Hash = HashStep(Hash, (unsigned char)(IsClass && c == '.' ? '/' : c));
+                if (IsClass)
+                {
+                    for (char c : ClassSuffix)
+                        Hash = HashStep(Hash, (unsigned char)c);
+                }
+
+                // Probe
+                const size_t NameSize = Name.size() + (IsClass ? ClassSuffix.size() : 0);
+                for (size_t Slot = (size_t)Hash & (Table.size() - 1); Table[Slot] != UINT32_MAX; Slot = (Slot + 1) & (Table.size() - 1))
+                {
+                    const Entry& Current = Entries[Table[Slot]];
+                    if (Current.Hash != Hash || Current.NameSize != NameSize)
+                        continue;
+
+                    // Compare name
+                    const char* EntryName = Mapping + Current.NameOffset;
+                    bool Match = true;
+                    for (size_t i = 0; Match && i < Name.size(); i++)
+                        Match = EntryName[i] == (IsClass && Name[i] == '.' ? '/' : Name[i]);
+                    if (Match && IsClass)
+                        Match = std::memcmp(EntryName + Name.size(), ClassSuffix.data(), ClassSuffix.size()) == 0;
+
+                    if (Match)
+                        return std::string_view(Mapping + Current.DataOffset, Current.DataSize);
+                }
+
+                return {};
+            }
+
+        private:
+            // Mapped file
+            const char* Mapping = nullptr;
+            size_t MappingSize = 0;
+
+            // Entry table inside the mapping
+            const Entry* Entries = nullptr;
+            size_t EntryCount = 0;
+
+            // Open addressing table (entry indices)
+            std::vector<uint32_t> Table;
+    };
+
+    // Compile time string (used for JNI descriptors and class names as template arguments)
+    template<size_t N>
+    struct FixedString
+    {
+        char Value[N] = {};
+
+        // Construct
+        constexpr FixedString() noexcept = default;
+        constexpr FixedString(const char(&Str)[N]) noexcept
+        {
+            for (size_t i = 0; i < N; i++)
+                Value[i] = Str[i];
+        }
+
+        // Access
+        constexpr size_t Size() const noexcept
+        {
+            return N - 1;
+        }
+        constexpr const char* CStr() const noexcept
+        {
+            return Value;
+        }
+        constexpr std::string_view View() const noexcept
+        {
+            return std::string_view(Value, N - 1);
+        }
+    };
+
+    // Concatenation
+    template<size_t A, size_t B>
+    constexpr FixedString<A + B - 1> operator+(const FixedString<A>& Left, const FixedString<B>& Right) noexcept
+    {
+        FixedString<A + B - 1> Result;
+        for (size_t i = 0; i < A - 1; i++)
+            Result.Value[i] = Left.Value[i];
+        for (size_t i = 0; i < B; i++)
+            Result.Value[A - 1 + i] = Right.Value[i];
+        return Result;
+    }
+
+    // Typed java reference ("java/util/List", "[Ljava/lang/String;") to get exact descriptors for non jni types
+    template<FixedString ClassName>
+    struct Object
+    {
+        jobject Ref = nullptr;
+
+        // Construct
+        constexpr Object() noexcept = default;
+        constexpr Object(jobject Ref) noexcept :
+            Ref(Ref)
+        {}
+
+        // Convert
+        constexpr operator jobject() const noexcept
+        {
+            return Ref;
+        }
+        explicit constexpr operator bool() const noexcept
+        {
+            return Ref != nullptr;
+        }
+    };
+
+    // Descriptor of a single type (specialize for own types)
+    template<typename T>
+    struct TypeSignature;
+
+    template<> struct TypeSignature<void> { static constexpr FixedString Value = "V"; };
+    template<> struct TypeSignature<jboolean> { static constexpr FixedString Value = "Z"; };
+    template<> struct TypeSignature<jbyte> { static constexpr FixedString Value = "B"; };
+    template<> struct TypeSignature<jchar> { static constexpr FixedString Value = "C"; };
+    template<> struct TypeSignature<jshort> { static constexpr FixedString Value = "S"; };
+    template<> struct TypeSignature<jint> { static constexpr FixedString Value = "I"; };
+    template<> struct TypeSignature<jlong> { static constexpr FixedString Value = "J"; };
+    template<> struct TypeSignature<jfloat> { static constexpr FixedString Value = "F"; };
+    template<> struct TypeSignature<jdouble> { static constexpr FixedString Value = "D"; };
+    template<> struct TypeSignature<jobject> { static constexpr FixedString Value = "Ljava/lang/Object;"; };
+    template<> struct TypeSignature<jclass> { static constexpr FixedString Value = "Ljava/lang/Class;"; };
+    template<> struct TypeSignature<jstring> { static constexpr FixedString Value = "Ljava/lang/String;"; };
+    template<> struct TypeSignature<jthrowable> { static constexpr FixedString Value = "Ljava/lang/Throwable;"; };
+    template<> struct TypeSignature<jbooleanArray> { static constexpr FixedString Value = "[Z"; };
+    template<> struct TypeSignature<jbyteArray> { static constexpr FixedString Value = "[B"; };
+    template<> struct TypeSignature<jcharArray> { static constexpr FixedString Value = "[C"; };
+    template<> struct TypeSignature<jshortArray> { static constexpr FixedString Value = "[S"; };
+    template<> struct TypeSignature<jintArray> { static constexpr FixedString Value = "[I"; };
+    template<> struct TypeSignature<jlongArray> { static constexpr FixedString Value = "[J"; };
+    template<> struct TypeSignature<jfloatArray> { static constexpr FixedString Value = "[F"; };
+    template<> struct TypeSignature<jdoubleArray> { static constexpr FixedString Value = "[D"; };
+    template<> struct TypeSignature<jobjectArray> { static constexpr FixedString Value = "[Ljava/lang/Object;"; };
+    template<FixedString ClassName>
+    struct TypeSignature<Object<ClassName>>
+    {
+        static constexpr auto Value = []()
+        {
+            if constexpr (ClassName.Value[0] == '[')
+                return ClassName;
+            else
+                return FixedString("L") + ClassName + FixedString(";");
+        }();
+    };
+
+    // Descriptor of a method type R(Args...)
+    template<typename T>
+    struct MethodSignature;
+    template<typename R, typename... Args>
+    struct MethodSignature<R(Args...)>
+    {
+        static constexpr auto Value = (FixedString("(") + ... + TypeSignature<Args>::Value) + FixedString(")") + TypeSignature<R>::Value;
+    };
+
+    // Java reference types (jobject, jstring, ..., jni::Object<...>)
+    template<typename T>
+    struct IsObjectType : std::bool_constant<std::is_convertible_v<T, jobject> && !std::is_same_v<T, std::nullptr_t>> {};
+    template<FixedString ClassName>
+    struct IsObjectType<Object<ClassName>> : std::true_type {};
+
+    // Packs a C++ value into a jvalue
+    template<typename T>
+    inline jvalue ToJValue(T Value) noexcept
+    {
+        jvalue Result;
+        if constexpr (std::is_same_v<T, jboolean>) Result.z = Value;
+        else if constexpr (std::is_same_v<T, jbyte>) Result.b = Value;
+        else if constexpr (std::is_same_v<T, jchar>) Result.c = Value;
+        else if constexpr (std::is_same_v<T, jshort>) Result.s = Value;
+        else if constexpr (std::is_same_v<T, jint>) Result.i = Value;
+        else if constexpr (std::is_same_v<T, jlong>) Result.j = Value;
+        else if constexpr (std::is_same_v<T, jfloat>) Result.f = Value;
+        else if constexpr (std::is_same_v<T, jdouble>) Result.d = Value;
+        else
+        {
+            static_assert(IsObjectType<T>::value, "Type has no jvalue representation");
+            Result.l = (jobject)Value;
+        }
+        return Result;
+    }
+
+    // Converts a returned jobject to the requested reference type
+    template<typename T>
+    inline T FromJObject(jobject Value) noexcept
+    {
+        if constexpr (std::is_pointer_v<T>)
+            return static_cast<T>(Value);
+        else
+            return T(Value);
+    }
+
+    // Call<Type>MethodA / CallStatic<Type>MethodA dispatch
+    template<typename T>
+    struct JNIDispatch
+    {
+        static T Call(::JNIEnv* Env, jobject Instance, jmethodID ID, const jvalue* Args) noexcept
+        {
+            if constexpr (std::is_same_v<T, void>) Env->CallVoidMethodA(Instance, ID, Args);
+            else if constexpr (std::is_same_v<T, jboolean>) return Env->CallBooleanMethodA(Instance, ID, Args);
+            else if constexpr (std::is_same_v<T, jbyte>) return Env->CallByteMethodA(Instance, ID, Args);
+            else if constexpr (std::is_same_v<T, jchar>) return Env->CallCharMethodA(Instance, ID, Args);
+            else if constexpr (std::is_same_v<T, jshort>) return Env->CallShortMethodA(Instance, ID, Args);
+            else if constexpr (std::is_same_v<T, jint>) return Env->CallIntMethodA(Instance, ID, Args);
+            else if constexpr (std::is_same_v<T, jlong>) return Env->CallLongMethodA(Instance, ID, Args);
+            else if constexpr (std::is_same_v<T, jfloat>) return Env->CallFloatMethodA(Instance, ID, Args);
+            else if constexpr (std::is_same_v<T, jdouble>) return Env->CallDoubleMethodA(Instance, ID, Args);
+            else return FromJObject<T>(Env->CallObjectMethodA(Instance, ID, Args));
+        }
+        static T CallStatic(::JNIEnv* Env, jclass Class, jmethodID ID, const jvalue* Args) noexcept
+        {
+            if constexpr (std::is_same_v<T, void>) Env->CallStaticVoidMethodA(Class, ID, Args);
+            else if constexpr (std::is_same_v<T, jboolean>) return Env->CallStaticBooleanMethodA(Class, ID, Args);
+            else if constexpr (std::is_same_v<T, jbyte>) return Env->CallStaticByteMethodA(Class, ID, Args);
+            else if constexpr (std::is_same_v<T, jchar>) return Env->CallStaticCharMethodA(Class, ID, Args);
+            else if constexpr (std::is_same_v<T, jshort>) return Env->CallStaticShortMethodA(Class, ID, Args);
+            else if constexpr (std::is_same_v<T, jint>) return Env->CallStaticIntMethodA(Class, ID, Args);
+            else if constexpr (std::is_same_v<T, jlong>) return Env->CallStaticLongMethodA(Class, ID, Args);
+            else if constexpr (std::is_same_v<T, jfloat>) return Env->CallStaticFloatMethodA(Class, ID, Args);
+            else if constexpr (std::is_same_v<T, jdouble>) return Env->CallStaticDoubleMethodA(Class, ID, Args);
+            else return FromJObject<T>(Env->CallStaticObjectMethodA(Class, ID, Args));
+        }
+    };
+
+    // Get<Type>Field / Set<Type>Field (and static) dispatch
+    template<typename T>
+    struct JNIFieldDispatch
+    {
+        static T Get(::JNIEnv* Env, jobject Instance, jfieldID ID) noexcept
+        {
+            if constexpr (std::is_same_v<T, jboolean>) return Env->GetBooleanField(Instance, ID);
+            else if constexpr (std::is_same_v<T, jbyte>) return Env->GetByteField(Instance, ID);
+            else if constexpr (std::is_same_v<T, jchar>) return Env->GetCharField(Instance, ID);
+            else if constexpr (std::is_same_v<T, jshort>) return Env->GetShortField(Instance, ID);
+            else if constexpr (std::is_same_v<T, jint>) return Env->GetIntField(Instance, ID);
+            else if constexpr (std::is_same_v<T, jlong>) return Env->GetLongField(Instance, ID);
+            else if constexpr (std::is_same_v<T, jfloat>) return Env->GetFloatField(Instance, ID);
+            else if constexpr (std::is_same_v<T, jdouble>) return Env->GetDoubleField(Instance, ID);
+            else return FromJObject<T>(Env->GetObjectField(Instance, ID));
+        }
+        static T GetStatic(::JNIEnv* Env, jclass Class, jfieldID ID) noexcept
+        {
+            if constexpr (std::is_same_v<T, jboolean>) return Env->GetStaticBooleanField(Class, ID);
+            else if constexpr (std::is_same_v<T, jbyte>) return Env->GetStaticByteField(Class, ID);
+            else if constexpr (std::is_same_v<T, jchar>) return Env->GetStaticCharField(Class, ID);
+            else if constexpr (std::is_same_v<T, jshort>) return Env->GetStaticShortField(Class, ID);
+            else if constexpr (std::is_same_v<T, jint>) return Env->GetStaticIntField(Class, ID);
+            else if constexpr (std::is_same_v<T, jlong>) return Env->GetStaticLongField(Class, ID);
+            else if constexpr (std::is_same_v<T, jfloat>) return Env->GetStaticFloatField(Class, ID);
+            else if constexpr (std::is_same_v<T, jdouble>) return Env->GetStaticDoubleField(Class, ID);
+            else return FromJObject<T>(Env->GetStaticObjectField(Class, ID));
+        }
+        static void Set(::JNIEnv* Env, jobject Instance, jfieldID ID, T Value) noexcept
+        {
+            if constexpr (std::is_same_v<T, jboolean>) Env->SetBooleanField(Instance, ID, Value);
+            else if constexpr (std::is_same_v<T, jbyte>) Env->SetByteField(Instance, ID, Value);
+            else if constexpr (std::is_same_v<T, jchar>) Env->SetCharField(Instance, ID, Value);
+            else if constexpr (std::is_same_v<T, jshort>) Env->SetShortField(Instance, ID, Value);
+            else if constexpr (std::is_same_v<T, jint>) Env->SetIntField(Instance, ID, Value);
+            else if constexpr (std::is_same_v<T, jlong>) Env->SetLongField(Instance, ID, Value);
+            else if constexpr (std::is_same_v<T, jfloat>) Env->SetFloatField(Instance, ID, Value);
+            else if constexpr (std::is_same_v<T, jdouble>) Env->SetDoubleField(Instance, ID, Value);
+            else Env->SetObjectField(Instance, ID, (jobject)Value);
+        }
+        static void SetStatic(::JNIEnv* Env, jclass Class, jfieldID ID, T Value) noexcept
+        {
+            if constexpr (std::is_same_v<T, jboolean>) Env->SetStaticBooleanField(Class, ID, Value);
+            else if constexpr (std::is_same_v<T, jbyte>) Env->SetStaticByteField(Class, ID, Value);
+            else if constexpr (std::is_same_v<T, jchar>) Env->SetStaticCharField(Class, ID, Value);
+            else if constexpr (std::is_same_v<T, jshort>) Env->SetStaticShortField(Class, ID, Value);
+            else if constexpr (std::is_same_v<T, jint>) Env->SetStaticIntField(Class, ID, Value);
+            else if constexpr (std::is_same_v<T, jlong>) Env->SetStaticLongField(Class, ID, Value);
+            else if constexpr (std::is_same_v<T, jfloat>) Env->SetStaticFloatField(Class, ID, Value);
+            else if constexpr (std::is_same_v<T, jdouble>) Env->SetStaticDoubleField(Class, ID, Value);
+            else Env->SetStaticObjectField(Class, ID, (jobject)Value);
+        }
+    };
+
+    // Shared base of the cached member handles: resolves the class once and pins it as global ref
+    template<typename IDType>
+    class MemberHandle
+    {
+        public:
+            // Construct (ClassName as for FindClass: "com/foo/Bar")
+            MemberHandle(const char* ClassName, const char* MemberName) noexcept :
+                ClassName(ClassName), MemberName(MemberName)
+            {}
+            MemberHandle(const MemberHandle&) = delete;
+            MemberHandle& operator=(const MemberHandle&) = delete;
+
+            // Access (valid after a successful Resolve)
+            jclass GetClass() const noexcept
+            {
+                return Class;
+            }
+            IDType GetID() const noexcept
+            {
+                return ID.load(std::memory_order_acquire);
+            }
+            bool IsResolved() const noexcept
+            {
+                return GetID() != nullptr;
+            }
+
+        protected:
+            // Resolve once (thread safe, the lookup runs at most once per handle unless it failed)
+            template<typename LookupFunction>
+            bool ResolveWith(::JNIEnv* Env, LookupFunction&& Lookup) noexcept
+            {
+                if (ID.load(std::memory_order_acquire))
+                    return true;
+
+                std::lock_guard<std::mutex> Lock(GetResolveMutex());
+                if (!ID.load(std::memory_order_relaxed))
+                {
+                    if (!Class)
+                    {
+                        jclass Local = Env->FindClass(ClassName);
+                        if (Local)
+                        {
+                            Class = (jclass)Env->NewGlobalRef(Local);
+                            Env->DeleteLocalRef(Local);
+                        }
+                    }
+                    if (Class)
+                    {
+                        ID.store(Lookup(Env, Class, MemberName), std::memory_order_release);
+                    }
+                }
+
+                return ID.load(std::memory_order_relaxed) != nullptr;
+            }
+
+        private:
+            // Resolution is rare: one mutex for all handles
+            static std::mutex& GetResolveMutex() noexcept
+            {
+                static std::mutex Mutex;
+                return Mutex;
+            }
+
+        private:
+            const char* ClassName;
+            const char* MemberName;
+            jclass Class = nullptr;
+            std::atomic<IDType> ID = nullptr;
+    };
+
+    // Value or java exception of a checked call (see jni::Try)
+    template<typename T>
+    class Result;
+
+    // Cached instance method handle: jni::Method<jint(jstring, jlong)> Length("com/foo/Bar", "length");
+    template<typename Signature>
+    class Method;
+    template<typename R, typename... Args>
+    class Method<R(Args...)> : public MemberHandle<jmethodID>
+    {
+        public:
+            // JNI descriptor ("(Ljava/lang/String;J)I")
+            static constexpr auto Descriptor = MethodSignature<R(Args...)>::Value;
+
+            // Construct
+            using MemberHandle<jmethodID>::MemberHandle;
+
+            // Lookup class and method id (once)
+            bool Resolve(::JNIEnv* Env) noexcept
+            {
+                return ResolveWith(Env, [](::JNIEnv* Env, jclass Class, const char* Name) { return Env->GetMethodID(Class, Name, Descriptor.CStr()); });
+            }
+
+            // Call (returns a default value when the method cannot be resolved)
+            R operator()(::JNIEnv* Env, jobject Instance, Args... Arguments) noexcept
+            {
+                if (!Resolve(Env))
+                    return R();
+
+                jvalue Values[sizeof...(Args) + 1] = { ToJValue<Args>(Arguments)... };
+                return JNIDispatch<R>::Call(Env, Instance, GetID(), Values);
+            }
+
+            // Call and return the value or the java exception
+            Result<R> Try(::JNIEnv* Env, jobject Instance, Args... Arguments);
+            // Call and throw a java exception as jni::JavaException
+            R Checked(::JNIEnv* Env, jobject Instance, Args... Arguments);
+    };
+
+    // Cached static method handle: jni::StaticMethod<void(jint)> Exit("java/lang/System", "exit");
+    template<typename Signature>
+    class StaticMethod;
+    template<typename R, typename... Args>
+    class StaticMethod<R(Args...)> : public MemberHandle<jmethodID>
+    {
+        public:
+            // JNI descriptor
+            static constexpr auto Descriptor = MethodSignature<R(Args...)>::Value;
+
+            // Construct
+            using MemberHandle<jmethodID>::MemberHandle;
+
+            // Lookup class and method id (once)
+            bool Resolve(::JNIEnv* Env) noexcept
+            {
+                return ResolveWith(Env, [](::JNIEnv* Env, jclass Class, const char* Name) { return Env->GetStaticMethodID(Class, Name, Descriptor.CStr()); });
+            }
+
+            // Call (returns a default value when the method cannot be resolved)
+            R operator()(::JNIEnv* Env, Args... Arguments) noexcept
+            {
+                if (!Resolve(Env))
+                    return R();
+
+                jvalue Values[sizeof...(Args) + 1] = { ToJValue<Args>(Arguments)... };
+                return JNIDispatch<R>::CallStatic(Env, GetClass(), GetID(), Values);
+            }
+
+            // Call and return the value or the java exception
+            Result<R> Try(::JNIEnv* Env, Args... Arguments);
+            // Call and throw a java exception as jni::JavaException
+            R Checked(::JNIEnv* Env, Args... Arguments);
+    };
+
+    // Cached instance field handle: jni::Field<jlong> Handle("com/foo/Bar", "handle");
+    template<typename T>
+    class Field : public MemberHandle<jfieldID>
+    {
+        public:
+            // JNI descriptor
+            static constexpr auto Descriptor = TypeSignature<T>::Value;
+
+            // Construct
+            using MemberHandle<jfieldID>::MemberHandle;
+
+            // Lookup class and field id (once)
+            bool Resolve(::JNIEnv* Env) noexcept
+            {
+                return ResolveWith(Env, [](::JNIEnv* Env, jclass Class, const char* Name) { return Env->GetFieldID(Class, Name, Descriptor.CStr()); });
+            }
+
+            // Read / write
+            T Get(::JNIEnv* Env, jobject Instance) noexcept
+            {
+                return Resolve(Env) ? JNIFieldDispatch<T>::Get(Env, Instance, GetID()) : T();
+            }
+            void Set(::JNIEnv* Env, jobject Instance, T Value) noexcept
+            {
+                if (Resolve(Env))
+                    JNIFieldDispatch<T>::Set(Env, Instance, GetID(), Value);
+            }
+    };
+
+    // Cached static field handle: jni::StaticField<jint> Max("java/lang/Integer", "MAX_VALUE");
+    template<typename T>
+    class StaticField : public MemberHandle<jfieldID>
+    {
+        public:
+            // JNI descriptor
+            static constexpr auto Descriptor = TypeSignature<T>::Value;
+
+            // Construct
+            using MemberHandle<jfieldID>::MemberHandle;
+
+            // Lookup class and field id (once)
+            bool Resolve(::JNIEnv* Env) noexcept
+            {
+                return ResolveWith(Env, [](::JNIEnv* Env, jclass Class, const char* Name) { return Env->GetStaticFieldID(Class, Name, Descriptor.CStr()); });
+            }
+
+            // Read / write
+            T Get(::JNIEnv* Env) noexcept
+            {
+                return Resolve(Env) ? JNIFieldDispatch<T>::GetStatic(Env, GetClass(), GetID()) : T();
+            }
+            void Set(::JNIEnv* Env, T Value) noexcept
+            {
+                if (Resolve(Env))
+                    JNIFieldDispatch<T>::SetStatic(Env, GetClass(), GetID(), Value);
+            }
+    };
+
+    // Primitive array types and their JNI accessors
+    template<typename T>
+    struct PrimitiveArrayTraits;
+    #define __JNIHPP_PRIMITIVE_ARRAY_TRAITS(type, name) \
+        template<> struct PrimitiveArrayTraits<type> \
+        { \
+            using ArrayType = type##Array; \
+            static ArrayType New(::JNIEnv* Env, jsize Length) noexcept { return Env->New##name##Array(Length); } \
+            static type* GetElements(::JNIEnv* Env, ArrayType Array, jboolean* IsCopy) noexcept { return Env->Get##name##ArrayElements(Array, IsCopy); } \
+            static void ReleaseElements(::JNIEnv* Env, ArrayType Array, type* Elements, jint Mode) noexcept { Env->Release##name##ArrayElements(Array, Elements, Mode); } \
+            static void GetRegion(::JNIEnv* Env, ArrayType Array, jsize Start, jsize Length, type* Buffer) noexcept { Env->Get##name##ArrayRegion(Array, Start, Length, Buffer); } \
+            static void SetRegion(::JNIEnv* Env, ArrayType Array, jsize Start, jsize Length, const type* Buffer) noexcept { Env->Set##name##ArrayRegion(Array, Start, Length, Buffer); } \
+        };
+    __JNIHPP_PRIMITIVE_ARRAY_TRAITS(jboolean, Boolean)
+    __JNIHPP_PRIMITIVE_ARRAY_TRAITS(jbyte, Byte)
+    __JNIHPP_PRIMITIVE_ARRAY_TRAITS(jchar, Char)
+    __JNIHPP_PRIMITIVE_ARRAY_TRAITS(jshort, Short)
+    __JNIHPP_PRIMITIVE_ARRAY_TRAITS(jint, Int)
+    __JNIHPP_PRIMITIVE_ARRAY_TRAITS(jlong, Long)
+    __JNIHPP_PRIMITIVE_ARRAY_TRAITS(jfloat, Float)
+    __JNIHPP_PRIMITIVE_ARRAY_TRAITS(jdouble, Double)
+    #undef __JNIHPP_PRIMITIVE_ARRAY_TRAITS
+
+    // Global and weak global refs waiting for deletion (handles can be dropped on any thread without a JNIEnv)
+    // Deletion happens in batches from a thread that has an env
+    class GlobalRefPool
+    {
+        public:
+            // Pending refs that trigger a release when a new global handle is created
+            static constexpr size_t DefaultBatch = 64;
+
+            // Process wide pool
+            static GlobalRefPool& Instance() noexcept
+            {
+                static GlobalRefPool Pool;
+                return Pool;
+            }
+
+            // Queue a ref for deletion (called from destructors, never throws)
+            void Defer(jobject Ref, bool Weak) noexcept
+            {
+                if (!Ref)
+                    return;
+
+                try
+                {
+                    std::lock_guard<std::mutex> Lock(Mutex);
+                    (Weak ? PendingWeak : PendingGlobal).push_back(Ref);
+                    Count.store(PendingGlobal.size() + PendingWeak.size(), std::memory_order_relaxed);
+                    return;
+                }
+                catch (...)
+                {
+                }
+
+                // Queue unavailable: delete now when this thread is attached, drop the ref otherwise
+                ::JavaVM* VM = nullptr;
+                ::JNIEnv* Env = nullptr;
+                jsize VMCount = 0;
+                if (JNI_GetCreatedJavaVMs(&VM, 1, &VMCount) == JNI_OK && VMCount == 1 && VM->GetEnv((void**)&Env, JNI_VERSION_1_8) == JNI_OK)
+                {
+                    if (Weak)
+                        Env->DeleteWeakGlobalRef((jweak)Ref);
+                    else
+                        Env->DeleteGlobalRef(Ref);
+                }
+            }
+
+            // Delete all queued refs (vectors keep their capacity)
+            void Release(::JNIEnv* Env) noexcept
+            {
+                std::lock_guard<std::mutex> Lock(Mutex);
+                for (jobject Ref : PendingGlobal)
+                {
+                    Env->DeleteGlobalRef(Ref);
+                }
+                for (jobject Ref : PendingWeak)
+                {
+                    Env->DeleteWeakGlobalRef((jweak)Ref);
+                }
+                PendingGlobal.clear();
+                PendingWeak.clear();
+                Count.store(0, std::memory_order_relaxed);
+            }
+            // Release only when at least Threshold refs are queued (lock free check)
+            void ReleaseIfAbove(::JNIEnv* Env, size_t Threshold = DefaultBatch) noexcept
+            {
+                if (Count.load(std::memory_order_relaxed) >= Threshold)
+                {
+                    Release(Env);
+                }
+            }
+            // Forget all queued refs without deleting them (the vm is gone)
+            void Discard() noexcept
+            {
+                std::lock_guard<std::mutex> Lock(Mutex);
+                PendingGlobal.clear();
+                PendingWeak.clear();
+                Count.store(0, std::memory_order_relaxed);
+            }
+
+            // Number of queued refs
+            size_t Pending() const noexcept
+            {
+                return Count.load(std::memory_order_relaxed);
+            }
+
+        private:
+            // Room for a few batches up front (Defer only allocates beyond that)
+            GlobalRefPool() noexcept
+            {
+                try
+                {
+                    PendingGlobal.reserve(4 * DefaultBatch);
+                    PendingWeak.reserve(DefaultBatch);
+                }
+                catch (...)
+                {
+                }
+            }
+
+        private:
+            std::mutex Mutex;
+            std::vector<jobject> PendingGlobal;
+            std::vector<jobject> PendingWeak;
+            std::atomic<size_t> Count = 0;
+    };
+
+    template<typename T>
+    class Global;
+
+    // Owning local ref (DeleteLocalRef on destruction)
+    template<typename T = jobject>
+    class Local
+    {
+        public:
+            // Construct (takes ownership of a local ref)
+            Local() = default;
+            Local(::JNIEnv* Env, T Ref) noexcept :
+                Env(Env),
+                Ref(Ref)
+            {}
+            Local(const Local&) = delete;
+            Local(Local&& Other) noexcept :
+                Env(Other.Env),
+                Ref(std::exchange(Other.Ref, nullptr))
+            {}
+            ~Local()
+            {
+                Reset();
+            }
+
+            // Move assign
+            Local& operator=(const Local&) = delete;
+            Local& operator=(Local&& Other) noexcept
+            {
+                if (this != &Other)
+                {
+                    Reset();
+                    Env = Other.Env;
+                    Ref = std::exchange(Other.Ref, nullptr);
+                }
+                return *this;
+            }
+
+            // Delete the ref now
+            void Reset() noexcept
+            {
+                if (Ref)
+                {
+                    Env->DeleteLocalRef(Ref);
+                    Ref = nullptr;
+                }
+            }
+            // Give up ownership
+            T Release() noexcept
+            {
+                return std::exchange(Ref, nullptr);
+            }
+
+            // Creates a global ref of the same object
+            Global<T> ToGlobal() const;
+
+            // Access
+            T Get() const noexcept
+            {
+                return Ref;
+            }
+            explicit operator bool() const noexcept
+            {
+                return Ref != nullptr;
+            }
+
+        private:
+            ::JNIEnv* Env = nullptr;
+            T Ref = nullptr;
+    };
+
+    // Owning global ref (deletion is queued on the GlobalRefPool, so no env is required on destruction)
+    template<typename T = jobject>
+    class Global
+    {
+        public:
+            // Construct (creates a new global ref)
+            Global() = default;
+            Global(::JNIEnv* Env, T Object) :
+                Ref(Object ? (T)Env->NewGlobalRef(Object) : nullptr)
+            {
+                // Drain dropped handles while we have an env
+                GlobalRefPool::Instance().ReleaseIfAbove(Env);
+            }
+            Global(const Global&) = delete;
+            Global(Global&& Other) noexcept :
+                Ref(std::exchange(Other.Ref, nullptr))
+            {}
+            ~Global()
+            {
+                Reset();
+            }
+
+            // Takes ownership of an existing global ref
+            static Global Adopt(T GlobalRef) noexcept
+            {
+                Global Handle;
+                Handle.Ref = GlobalRef;
+                return Handle;
+            }
+
+            // Move assign
+            Global& operator=(const Global&) = delete;
+            Global& operator=(Global&& Other) noexcept
+            {
+                if (this != &Other)
+                {
+                    Reset();
+                    Ref = std::exchange(Other.Ref, nullptr);
+                }
+                return *this;
+            }
+
+            // Drop the ref (deleted with the next batch)
+            void Reset() noexcept
+            {
+                if (Ref)
+                {
+                    GlobalRefPool::Instance().Defer(Ref, false);
+                    Ref = nullptr;
+                }
+            }
+            // Delete the ref now
+            void Reset(::JNIEnv* Env) noexcept
+            {
+                if (Ref)
+                {
+                    Env->DeleteGlobalRef(Ref);
+                    Ref = nullptr;
+                }
+            }
+            // Give up ownership
+            T Release() noexcept
+            {
+                return std::exchange(Ref, nullptr);
+            }
+
+            // Access
+            T Get() const noexcept
+            {
+                return Ref;
+            }
+            explicit operator bool() const noexcept
+            {
+                return Ref != nullptr;
+            }
+
+        private:
+            T Ref = nullptr;
+    };
+
+    template<typename T>
+    inline Global<T> Local<T>::ToGlobal() const
+    {
+        return Global<T>(Env, Ref);
+    }
+
+    // Owning weak global ref (does not keep the object alive)
+    template<typename T = jobject>
+    class Weak
+    {
+        public:
+            // Construct (creates a new weak global ref)
+            Weak() = default;
+            Weak(::JNIEnv* Env, T Object) :
+                Ref(Object ? Env->NewWeakGlobalRef(Object) : nullptr)
+            {
+                GlobalRefPool::Instance().ReleaseIfAbove(Env);
+            }
+            Weak(const Weak&) = delete;
+            Weak(Weak&& Other) noexcept :
+                Ref(std::exchange(Other.Ref, nullptr))
+            {}
+            ~Weak()
+            {
+                Reset();
+            }
+
+            // Move assign
+            Weak& operator=(const Weak&) = delete;
+            Weak& operator=(Weak&& Other) noexcept
+            {
+                if (this != &Other)
+                {
+                    Reset();
+                    Ref = std::exchange(Other.Ref, nullptr);
+                }
+                return *this;
+            }
+
+            // Drop the ref (deleted with the next batch)
+            void Reset() noexcept
+            {
+                if (Ref)
+                {
+                    GlobalRefPool::Instance().Defer(Ref, true);
+                    Ref = nullptr;
+                }
+            }
+
+            // Strong local ref to the object (empty when it was collected)
+            Local<T> Lock(::JNIEnv* Env) const noexcept
+            {
+                return Local<T>(Env, Ref ? (T)Env->NewLocalRef(Ref) : nullptr);
+            }
+            // Checks if the object was collected
+            bool IsCollected(::JNIEnv* Env) const noexcept
+            {
+                return !Ref || Env->IsSameObject(Ref, nullptr);
+            }
+
+        private:
+            jweak Ref = nullptr;
+    };
+
+    // RAII local ref frame: every local ref created in the scope is freed on exit (one JNI call, no per ref deletes)
+    //   jni::LocalFrame Frame(Env, 8); ... return Frame.Escape(Result);
+    class LocalFrame
+    {
+        public:
+            // Construct (Capacity is the number of local refs the scope needs)
+            LocalFrame(::JNIEnv* Env, jint Capacity = 16) noexcept :
+                Env(Env),
+                Active(Env->PushLocalFrame(Capacity) == JNI_OK)
+            {}
+            LocalFrame(const LocalFrame&) = delete;
+            LocalFrame& operator=(const LocalFrame&) = delete;
+            ~LocalFrame()
+            {
+                if (Active)
+                {
+                    Env->PopLocalFrame(nullptr);
+                }
+            }
+
+            // Pops the frame and returns Result as local ref of the outer frame
+            template<typename T>
+            T Escape(T Result) noexcept
+            {
+                if (!Active)
+                {
+                    return Result;
+                }
+                Active = false;
+                return (T)Env->PopLocalFrame(Result);
+            }
+
+            // False when the frame could not be pushed (OutOfMemoryError is pending)
+            explicit operator bool() const noexcept
+            {
+                return Active;
+            }
+
+        private:
+            ::JNIEnv* Env;
+            bool Active;
+    };
+
+    // Thread local pool of growable scratch buffers (no heap allocation once the pool is warm)
+    class ScratchBuffer
+    {
+        public:
+            // Construct with at least Size bytes
+            explicit ScratchBuffer(size_t Size = 0)
+            {
+                std::vector<std::vector<std::byte>>& Pool = GetPool();
+                if (!Pool.empty())
+                {
+                    Buffer = std::move(Pool.back());
+                    Pool.pop_back();
+                }
+                Reserve(Size);
+            }
+            ScratchBuffer(const ScratchBuffer&) = delete;
+            ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+
+            // Return to the pool
+            ~ScratchBuffer()
+            {
+                if (Buffer.capacity())
+                {
+                    GetPool().push_back(std::move(Buffer));
+                }
+            }
+
+            // Grow (content is not preserved)
+            void Reserve(size_t Size)
+            {
+                if (Buffer.size() < Size)
+                {
+                    Buffer.clear();
+                    Buffer.resize(Size);
+                }
+            }
+
+            // Access
+            template<typename T = std::byte>
+            T* Data() noexcept
+            {
+                return (T*)Buffer.data();
+            }
+            size_t Size() const noexcept
+            {
+                return Buffer.size();
+            }
+
+        private:
+            static std::vector<std::vector<std::byte>>& GetPool() noexcept
+            {
+                thread_local std::vector<std::vector<std::byte>> Pool;
+                return Pool;
+            }
+
+        private:
+            std::vector<std::byte> Buffer;
+    };
+
+    // How changes made through a view are handled on release
+    enum class ReleaseMode : jint
+    {
+        // Copy back (if needed) and release
+        Commit = 0,
+        // Discard changes and release
+        Abort = JNI_ABORT,
+    };
+
+    // RAII view over a primitive java array using Get<Type>ArrayElements (JNI calls are allowed while alive)
+    template<typename T>
+    class ArrayView
+    {
+        public:
+            using ArrayType = typename PrimitiveArrayTraits<T>::ArrayType;
+
+            // Construct
+            ArrayView() noexcept = default;
+            ArrayView(::JNIEnv* Env, ArrayType Array, ReleaseMode Mode = ReleaseMode::Commit) noexcept :
+                Env(Env), Array(Array), Mode(Mode)
+            {
+                if (Array)
+                {
+                    jboolean Copy = JNI_FALSE;
+                    Elements = PrimitiveArrayTraits<T>::GetElements(Env, Array, &Copy);
+                    Length = Elements ? (size_t)Env->GetArrayLength(Array) : 0;
+                    Copied = Copy == JNI_TRUE;
+                }
+            }
+            ArrayView(const ArrayView&) = delete;
+            ArrayView(ArrayView&& Other) noexcept
+            {
+                *this = std::move(Other);
+            }
+
+            // Assign
+            ArrayView& operator=(const ArrayView&) = delete;
+            ArrayView& operator=(ArrayView&& Other) noexcept
+            {
+                if (&Other != this)
+                {
+                    Release();
+                    Env = Other.Env;
+                    Array = Other.Array;
+                    Mode = Other.Mode;
+                    Elements = std::exchange(Other.Elements, nullptr);
+                    Length = std::exchange(Other.Length, 0);
+                    Copied = Other.Copied;
+                }
+                return *this;
+            }
+
+            // Destruct
+            ~ArrayView()
+            {
+                Release();
+            }
+
+            // Copy changes back without releasing (only does work when the vm handed out a copy)
+            void Commit() noexcept
+            {
+                if (Elements && Copied)
+                    PrimitiveArrayTraits<T>::ReleaseElements(Env, Array, Elements, JNI_COMMIT);
+            }
+            // Release now (Mode defaults to the mode given on construction)
+            void Release() noexcept
+            {
+                Release(Mode);
+            }
+            void Release(ReleaseMode ReleaseAs) noexcept
+            {
+                if (Elements)
+                    PrimitiveArrayTraits<T>::ReleaseElements(Env, Array, Elements, (jint)ReleaseAs);
+                Elements = nullptr;
+                Length = 0;
+            }
+
+            // Access
+            std::span<T> Span() const noexcept
+            {
+                return std::span<T>(Elements, Length);
+            }
+            T* Data() const noexcept
+            {
+                return Elements;
+            }
+            size_t Size() const noexcept
+            {
+                return Length;
+            }
+            T* begin() const noexcept
+            {
+                return Elements;
+            }
+            T* end() const noexcept
+            {
+                return Elements + Length;
+            }
+            T& operator[](size_t Index) const noexcept
+            {
+                return Elements[Index];
+            }
+            bool IsCopy() const noexcept
+            {
+                return Copied;
+            }
+            explicit operator bool() const noexcept
+            {
+                return Elements != nullptr;
+            }
+
+        private:
+            ::JNIEnv* Env = nullptr;
+            ArrayType Array = nullptr;
+            ReleaseMode Mode = ReleaseMode::Commit;
+            T* Elements = nullptr;
+            size_t Length = 0;
+            bool Copied = false;
+    };
+
+    // RAII view using GetPrimitiveArrayCritical (zero copy on most vms, NO JNI calls while alive)
+    // Falls back to Get<Type>ArrayRegion into a caller supplied or pooled buffer when critical access is not allowed or fails
+    template<typename T>
+    class CriticalArrayView
+    {
+        public:
+            using ArrayType = typename PrimitiveArrayTraits<T>::ArrayType;
+
+            // Construct
+            CriticalArrayView(::JNIEnv* Env, ArrayType Array, ReleaseMode Mode = ReleaseMode::Commit, bool AllowCritical = true, std::span<T> Buffer = {}) :
+                CriticalArrayView(Env, Array, Mode, AllowCritical, Buffer, SIZE_MAX, true)
+            {
+            }
+            CriticalArrayView(const CriticalArrayView&) = delete;
+            CriticalArrayView& operator=(const CriticalArrayView&) = delete;
+
+            // Write only view over the first Count elements (at most the array length)
+            // The fallback skips the region read, the caller must overwrite every element before the commit
+            static CriticalArrayView WriteOnly(::JNIEnv* Env, ArrayType Array, size_t Count, bool AllowCritical = true, std::span<T> Buffer = {})
+            {
+                return CriticalArrayView(Env, Array, ReleaseMode::Commit, AllowCritical, Buffer, Count, false);
+            }
+
+        private:
+            CriticalArrayView(::JNIEnv* Env, ArrayType Array, ReleaseMode Mode, bool AllowCritical, std::span<T> Buffer, size_t Limit, bool Read) :
+                Env(Env), Array(Array), Mode(Mode)
+            {
+                if (!Array)
+                    return;
+
+                Length = std::min((size_t)Env->GetArrayLength(Array), Limit);
+                if (AllowCritical)
+                {
+                    Elements = (T*)Env->GetPrimitiveArrayCritical(Array, nullptr);
+                    Critical = Elements != nullptr;
+
+                    // OutOfMemoryError pending: no further JNI calls, the view stays empty
+                    if (!Critical && Env->ExceptionCheck())
+                    {
+                        Length = 0;
+                        return;
+                    }
+                }
+                if (!Elements)
+                {
+                    // Copy into the caller buffer or a pooled one
+                    if (Buffer.size() >= Length)
+                    {
+                        Elements = Buffer.data();
+                    }
+                    else
+                    {
+                        Pooled.Reserve(Length * sizeof(T));
+                        Elements = Pooled.Data<T>();
+                    }
+                    if (Read)
+                        PrimitiveArrayTraits<T>::GetRegion(Env, Array, 0, (jsize)Length, Elements);
+                }
+            }
+
+        public:
+            // Destruct
+            ~CriticalArrayView()
+            {
+                Release();
+            }
+
+            // Leave the critical region now (Mode defaults to the mode given on construction)
+            void Release() noexcept
+            {
+                Release(Mode);
+            }
+            void Release(ReleaseMode ReleaseAs) noexcept
+            {
+                if (Elements)
+                {
+                    if (Critical)
+                        Env->ReleasePrimitiveArrayCritical(Array, Elements, (jint)ReleaseAs);
+                    else if (ReleaseAs == ReleaseMode::Commit)
+                        PrimitiveArrayTraits<T>::SetRegion(Env, Array, 0, (jsize)Length, Elements);
+                }
+                Elements = nullptr;
+                Length = 0;
+            }
+
+            // Access
+            std::span<T> Span() const noexcept
+            {
+                return std::span<T>(Elements, Length);
+            }
+            T* Data() const noexcept
+            {
+                return Elements;
+            }
+            size_t Size() const noexcept
+            {
+                return Length;
+            }
+            T* begin() const noexcept
+            {
+                return Elements;
+            }
+            T* end() const noexcept
+            {
+                return Elements + Length;
+            }
+            T& operator[](size_t Index) const noexcept
+            {
+                return Elements[Index];
+            }
+            bool IsCritical() const noexcept
+            {
+                return Critical;
+            }
+            explicit operator bool() const noexcept
+            {
+                return Elements != nullptr;
+            }
+
+        private:
+            ::JNIEnv* Env;
+            ArrayType Array;
+            ReleaseMode Mode;
+            T* Elements = nullptr;
+            size_t Length = 0;
+            bool Critical = false;
+            ScratchBuffer Pooled;
+    };
+
+    // Byte order reversal of trivially copyable 2, 4 or 8 byte values (plain loop, vectorized by the compiler)
+    template<typename T>
+    inline void ByteSwap(const T* Source, T* Destination, size_t Count) noexcept
+    {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "Unsupported element size");
+        using U = std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+        for (size_t i = 0; i < Count; i++)
+        {
+            U Value;
+            std::memcpy(&Value, Source + i, sizeof(U));
+            if constexpr (sizeof(U) == 2)
+                Value = (U)((Value << 8) | (Value >> 8));
+            else if constexpr (sizeof(U) == 4)
+                Value = ((Value & 0x000000FFu) << 24) | ((Value & 0x0000FF00u) << 8) | ((Value & 0x00FF0000u) >> 8) | ((Value & 0xFF000000u) >> 24);
+            else
+                Value =
+                    ((Value & 0x00000000000000FFull) << 56) | ((Value & 0x000000000000FF00ull) << 40) |
+                    ((Value & 0x0000000000FF0000ull) << 24) | ((Value & 0x00000000FF000000ull) << 8) |
+                    ((Value & 0x000000FF00000000ull) >> 8) | ((Value & 0x0000FF0000000000ull) >> 24) |
+                    ((Value & 0x00FF000000000000ull) >> 40) | ((Value & 0xFF00000000000000ull) >> 56);
+            std::memcpy(Destination + i, &Value, sizeof(U));
+        }
+    }
+
+    // UTF-16 (java chars) to standard UTF-8 (surrogate pairs become 4 byte sequences, unpaired surrogates U+FFFD)
+    // Destination must hold 3 * Length bytes, returns the number of bytes written
+    inline size_t Utf16ToUtf8(const jchar* Source, size_t Length, char* Destination) noexcept
+    {
+        char* Out = Destination;
+        size_t i = 0;
+        while (i < Length)
+        {
+            // ASCII fast path (blocks of 8)
+            while (i + 8 <= Length)
+            {
+                jchar Mask = 0;
+                for (size_t k = 0; k < 8; k++)
+                    Mask |= Source[i + k];
+                if (Mask >= 0x80)
+                    break;
+                for (size_t k = 0; k < 8; k++)
+                    Out[k] = (char)Source[i + k];
+                Out += 8;
+                i += 8;
+            }
+            if (i >= Length)
+                break;
+
+            uint32_t Code = Source[i++];
+            if (Code >= 0xD800 && Code <= 0xDFFF)
+            {
+                // Surrogates
+                if (Code <= 0xDBFF && i < Length && Source[i] >= 0xDC00 && Source[i] <= 0xDFFF)
+                    Code = 0x10000 + ((Code - 0xD800) << 10) + (Source[i++] - 0xDC00);
+                else
+                    Code = 0xFFFD;
+            }
+
+            if (Code < 0x80)
+            {
+                *Out++ = (char)Code;
+            }
+            else if (Code < 0x800)
+            {
+                *Out++ = (char)(0xC0 | (Code >> 6));
+                *Out++ = (char)(0x80 | (Code & 0x3F));
+            }
+            else if (Code < 0x10000)
+            {
+                *Out++ = (char)(0xE0 | (Code >> 12));
+                *Out++ = (char)(0x80 | ((Code >> 6) & 0x3F));
+                *Out++ = (char)(0x80 | (Code & 0x3F));
+            }
+            else
+            {
+                *Out++ = (char)(0xF0 | (Code >> 18));
+                *Out++ = (char)(0x80 | ((Code >> 12) & 0x3F));
+                *Out++ = (char)(0x80 | ((Code >> 6) & 0x3F));
+                *Out++ = (char)(0x80 | (Code & 0x3F));
+            }
+        }
+
+        return (size_t)(Out - Destination);
+    }
+
+    // Standard UTF-8 to UTF-16 (invalid sequences become U+FFFD)
+    // Destination must hold Length chars, returns the number of chars written
+    inline size_t Utf8ToUtf16(const char* Source, size_t Length, jchar* Destination) noexcept
+    {
+        const unsigned char* In = (const unsigned char*)Source;
+        jchar* Out = Destination;
+        size_t i = 0;
+        while (i < Length)
+        {
+            // ASCII fast path (blocks of 8)
+            while (i + 8 <= Length)
+            {
+                unsigned char Mask = 0;
+                for (size_t k = 0; k < 8; k++)
+                    Mask |= In[i + k];
+                if (Mask >= 0x80)
+                    break;
+                for (size_t k = 0; k < 8; k++)
+                    Out[k] = In[i + k];
+                Out += 8;
+                i += 8;
+            }
+            if (i >= Length)
+                break;
+
+            // Decode one sequence
+            uint32_t Code = In[i];
+            size_t Extra = Code < 0x80 ? 0 : (Code >> 5) == 0x6 ? 1 : (Code >> 4) == 0xE ? 2 : (Code >> 3) == 0x1E ? 3 : 4;
+            bool Valid = Extra < 4;
+            if (Extra && Valid)
+            {
+                uint32_t Minimum = Extra == 1 ? 0x80 : Extra == 2 ? 0x800 : 0x10000;
+                Code &= 0x3F >> Extra;
+                for (size_t k = 1; Valid && k <= Extra; k++)
+                {
+                    Valid = i + k < Length && (In[i + k] & 0xC0) == 0x80;
+                    Code = (Code << 6) | (Valid ? In[i + k] & 0x3F : 0);
+                }
+                Valid = Valid && Code >= Minimum && Code <= 0x10FFFF && !(Code >= 0xD800 && Code <= 0xDFFF);
+            }
+            if (!Valid)
+            {
+                *Out++ = 0xFFFD;
+                i++;
+                continue;
+            }
+            i += Extra + 1;
+
+            if (Code < 0x10000)
+            {
+                *Out++ = (jchar)Code;
+            }
+            else
+            {
+                Code -= 0x10000;
+                *Out++ = (jchar)(0xD800 + (Code >> 10));
+                *Out++ = (jchar)(0xDC00 + (Code & 0x3FF));
+            }
+        }
+
+        return (size_t)(Out - Destination);
+    }
+
+    // Reads a java array into Destination with reversed byte order (converted inside the critical region)
+    template<typename T>
+    inline size_t ReadArraySwapped(::JNIEnv* Env, typename PrimitiveArrayTraits<T>::ArrayType Array, std::span<T> Destination)
+    {
+        CriticalArrayView<T> View(Env, Array, ReleaseMode::Abort);
+        size_t Count = std::min(View.Size(), Destination.size());
+        ByteSwap(View.Data(), Destination.data(), Count);
+        return Count;
+    }
+
+    // Writes Source into a java array with reversed byte order (converted inside the critical region)
+    template<typename T>
+    inline size_t WriteArraySwapped(::JNIEnv* Env, typename PrimitiveArrayTraits<T>::ArrayType Array, std::span<const T> Source)
+    {
+        CriticalArrayView<T> View = CriticalArrayView<T>::WriteOnly(Env, Array, Source.size());
+        ByteSwap(Source.data(), View.Data(), View.Size());
+        return View.Size();
+    }
+
+    // Appends the content of a java char[] as UTF-8 (converted inside the critical region)
+    inline size_t ReadCharArrayUtf8(::JNIEnv* Env, jcharArray Array, std::string& Destination)
+    {
+        if (!Array)
+            return 0;
+
+        // Grow before entering the critical region (no allocation while the gc may be blocked)
+        size_t Offset = Destination.size();
+        Destination.resize(Offset + (size_t)Env->GetArrayLength(Array) * 3);
+        CriticalArrayView<jchar> View(Env, Array, ReleaseMode::Abort);
+        size_t Count = Utf16ToUtf8(View.Data(), View.Size(), Destination.data() + Offset);
+        Destination.resize(Offset + Count);
+        return Count;
+    }
+
+    // Creates a java char[] from UTF-8 text
+    inline jcharArray NewCharArrayUtf8(::JNIEnv* Env, std::string_view Source)
+    {
+        ScratchBuffer Buffer(Source.size() * sizeof(jchar));
+        size_t Count = Utf8ToUtf16(Source.data(), Source.size(), Buffer.Data<jchar>());
+        jcharArray Array = Env->NewCharArray((jsize)Count);
+        if (Array)
+            Env->SetCharArrayRegion(Array, 0, (jsize)Count, Buffer.Data<jchar>());
+        return Array;
+    }
+
+    // Java string as standard UTF-8 in a pooled thread local buffer (no heap allocation once the pool is warm)
+    // The view is valid as long as this object lives
+    class StringView
+    {
+        public:
+            // Construct (null strings give an empty view)
+            StringView(::JNIEnv* Env, jstring String)
+            {
+                if (String)
+                {
+                    // Copy the UTF-16 chars once and convert them
+                    size_t Length = (size_t)Env->GetStringLength(String);
+                    ScratchBuffer Chars(Length * sizeof(jchar));
+                    Env->GetStringRegion(String, 0, (jsize)Length, Chars.Data<jchar>());
+
+                    Buffer.Reserve(Length * 3 + 1);
+                    size_t Size = Utf16ToUtf8(Chars.Data<jchar>(), Length, Buffer.Data<char>());
+                    Buffer.Data<char>()[Size] = '\0';
+                    Value = std::string_view(Buffer.Data<char>(), Size);
+                }
+            }
+            StringView(const StringView&) = delete;
+            StringView& operator=(const StringView&) = delete;
+
+            // Access
+            std::string_view View() const noexcept
+            {
+                return Value;
+            }
+            operator std::string_view() const noexcept
+            {
+                return Value;
+            }
+            const char* CStr() const noexcept
+            {
+                return Value.data() ? Value.data() : "";
+            }
+            size_t Size() const noexcept
+            {
+                return Value.size();
+            }
+
+        private:
+            ScratchBuffer Buffer;
+            std::string_view Value;
+    };
+
+    // Creates a java string from standard UTF-8 (local ref)
+    inline jstring NewString(::JNIEnv* Env, std::string_view Utf8)
+    {
+        ScratchBuffer Chars(Utf8.size() * sizeof(jchar));
+        size_t Length = Utf8ToUtf16(Utf8.data(), Utf8.size(), Chars.Data<jchar>());
+        return Env->NewString(Chars.Data<jchar>(), (jsize)Length);
+    }
+
+    // Java string created once and kept as global ref (valid while the vm runs)
+    //   static jni::ConstString Name("name");  Name.Get(Env);
+    class ConstString
+    {
+        public:
+            // Construct
+            constexpr ConstString(const char* Utf8) noexcept :
+                Utf8(Utf8)
+            {}
+            ConstString(const ConstString&) = delete;
+            ConstString& operator=(const ConstString&) = delete;
+
+            // Get (creates the string on first use)
+            jstring Get(::JNIEnv* Env) noexcept
+            {
+                jstring Cached = Ref.load(std::memory_order_acquire);
+                if (!Cached)
+                {
+                    jstring Local = NewString(Env, Utf8);
+                    if (Local)
+                    {
+                        jstring Global = (jstring)Env->NewGlobalRef(Local);
+                        Env->DeleteLocalRef(Local);
+
+                        // First one wins
+                        if (Ref.compare_exchange_strong(Cached, Global, std::memory_order_acq_rel))
+                            Cached = Global;
+                        else
+                            Env->DeleteGlobalRef(Global);
+                    }
+                }
+                return Cached;
+            }
+
+        private:
+            const char* Utf8;
+            std::atomic<jstring> Ref = nullptr;
+    };
+
+    // Cached global ref of a string literal: jni::Intern<"name">(Env)
+    template<FixedString Value>
+    inline jstring Intern(::JNIEnv* Env) noexcept
+    {
+        static ConstString String(Value.CStr());
+        return String.Get(Env);
+    }
+
+    // Java exception taken from the env (the throwable is pinned, describing it is lazy)
+    // Copies share the throwable, an empty JavaException means "no exception" and owns nothing
+    class JavaException : public std::exception
+    {
+        public:
+            // Construct empty
+            JavaException() noexcept = default;
+            // Construct from a throwable (a new global ref is created)
+            JavaException(::JNIEnv* Env, jthrowable Throwable) :
+                Shared(Throwable ? std::make_shared<State>(Env, Throwable) : nullptr)
+            {}
+
+            // Java object
+            jthrowable GetThrowable() const noexcept
+            {
+                return Shared ? Shared->Throwable.Get() : nullptr;
+            }
+            explicit operator bool() const noexcept
+            {
+                return Shared != nullptr;
+            }
+
+            // Binary class name ("java.lang.IllegalStateException")
+            std::string GetClassName(::JNIEnv* Env) const
+            {
+                std::string Name;
+                jthrowable Throwable = GetThrowable();
+                if (Throwable && !Env->ExceptionCheck())
+                {
+                    jclass JAVA_Class = Env->GetObjectClass(Throwable);
+                    Name = ToString(Env, Methods().GetName(Env, JAVA_Class));
+                    Env->DeleteLocalRef(JAVA_Class);
+                }
+                return Name;
+            }
+            // Throwable.getMessage() (empty for null)
+            std::string GetMessage(::JNIEnv* Env) const
+            {
+                jthrowable Throwable = GetThrowable();
+                return Throwable && !Env->ExceptionCheck() ? ToString(Env, Methods().GetMessage(Env, Throwable)) : std::string();
+            }
+            // Throwable.toString() followed by one "\tat frame" line per stack frame
+            std::string Describe(::JNIEnv* Env) const
+            {
+                jthrowable Throwable = GetThrowable();
+                if (!Throwable || Env->ExceptionCheck())
+                    return std::string();
+
+                LocalFrame Frame(Env, 8);
+                std::string Text = ToString(Env, Methods().ToString(Env, Throwable));
+                jobjectArray JAVA_Frames = (jobjectArray)Methods().GetStackTrace(Env, Throwable).Ref;
+                jsize Count = JAVA_Frames ? Env->GetArrayLength(JAVA_Frames) : 0;
+                for (jsize i = 0; i < Count; i++)
+                {
+                    jobject JAVA_Frame = Env->GetObjectArrayElement(JAVA_Frames, i);
+                    Text += "\n\tat ";
+                    Text += ToString(Env, Methods().FrameToString(Env, JAVA_Frame));
+                    Env->DeleteLocalRef(JAVA_Frame);
+                }
+                Env->ExceptionClear();
+                return Text;
+            }
+
+            // Describe() of the calling thread's env (computed once)
+            const char* what() const noexcept override
+            {
+                if (!Shared)
+                    return "No java exception";
+
+                std::call_once(Shared->Once, [this]()
+                {
+                    ::JNIEnv* Env = nullptr;
+                    ::JavaVM* VM = nullptr;
+                    jsize Count = 0;
+                    if (JNI_GetCreatedJavaVMs(&VM, 1, &Count) == JNI_OK && Count == 1 && VM->GetEnv((void**)&Env, JNI_VERSION_1_8) == JNI_OK)
+                    {
+                        Shared->Text = Describe(Env);
+                    }
+                    if (Shared->Text.empty())
+                    {
+                        Shared->Text = "Java exception (the calling thread is not attached)";
+                    }
+                });
+                return Shared->Text.c_str();
+            }
+
+            // Throws the exception back into java (e.g. out of a native method)
+            void Throw(::JNIEnv* Env) const noexcept
+            {
+                if (GetThrowable())
+                {
+                    Env->Throw(GetThrowable());
+                }
+            }
+
+        private:
+            // Cached method handles (resolved on the first failure only)
+            struct ThrowableMethods
+            {
+                Method<jstring()> ToString{ "java/lang/Throwable", "toString" };
+                Method<jstring()> GetMessage{ "java/lang/Throwable", "getMessage" };
+                Method<Object<"[Ljava/lang/StackTraceElement;">()> GetStackTrace{ "java/lang/Throwable", "getStackTrace" };
+                Method<jstring()> FrameToString{ "java/lang/StackTraceElement", "toString" };
+                Method<jstring()> GetName{ "java/lang/Class", "getName" };
+            };
+            static ThrowableMethods& Methods()
+            {
+                static ThrowableMethods Instance;
+                return Instance;
+            }
+
+            // Converts and deletes a returned string (a java failure gives an empty string)
+            static std::string ToString(::JNIEnv* Env, jstring String)
+            {
+                std::string Value;
+                if (Env->ExceptionCheck())
+                {
+                    Env->ExceptionClear();
+                }
+                else if (String)
+                {
+                    Value = StringView(Env, String).View();
+                }
+                if (String)
+                {
+                    Env->DeleteLocalRef(String);
+                }
+                return Value;
+            }
+
+            struct State
+            {
+                State(::JNIEnv* Env, jthrowable Throwable) :
+                    Throwable(Env, Throwable)
+                {}
+
+                Global<jthrowable> Throwable;
+                std::once_flag Once;
+                std::string Text;
+            };
+
+        private:
+            std::shared_ptr<State> Shared;
+    };
+
+    // Takes the pending java exception (a single ExceptionCheck when there is none, no local ref is created)
+    inline JavaException TakeException(::JNIEnv* Env)
+    {
+        if (!Env->ExceptionCheck())
+            return JavaException();
+
+        jthrowable JAVA_Throwable = Env->ExceptionOccurred();
+        Env->ExceptionClear();
+        JavaException Error(Env, JAVA_Throwable);
+        Env->DeleteLocalRef(JAVA_Throwable);
+        return Error;
+    }
+    // Throws the pending java exception as jni::JavaException
+    inline void ThrowPendingException(::JNIEnv* Env)
+    {
+        if (Env->ExceptionCheck())
+            throw TakeException(Env);
+    }
+
+    // Value of a java call or the java exception it raised (expected style)
+    template<typename T>
+    class Result
+    {
+        public:
+            // Construct
+            Result(T Value) noexcept(std::is_nothrow_move_constructible_v<T>) :
+                Value(std::move(Value))
+            {}
+            Result(JavaException Error) noexcept :
+                Error(std::move(Error))
+            {}
+
+            // State
+            bool HasValue() const noexcept
+            {
+                return !Error;
+            }
+            explicit operator bool() const noexcept
+            {
+                return HasValue();
+            }
+
+            // Value (throws the java exception when there is none)
+            T& GetValue() &
+            {
+                if (Error)
+                    throw Error;
+                return *Value;
+            }
+            T GetValue() &&
+            {
+                if (Error)
+                    throw Error;
+                return std::move(*Value);
+            }
+            T ValueOr(T Default) const
+            {
+                return Error ? std::move(Default) : *Value;
+            }
+            T& operator*() noexcept
+            {
+                return *Value;
+            }
+            T* operator->() noexcept
+            {
+                return &*Value;
+            }
+
+            // Exception (empty on success)
+            const JavaException& GetError() const noexcept
+            {
+                return Error;
+            }
+
+        private:
+            std::optional<T> Value;
+            JavaException Error;
+    };
+    template<>
+    class Result<void>
+    {
+        public:
+            // Construct
+            Result() noexcept = default;
+            Result(JavaException Error) noexcept :
+                Error(std::move(Error))
+            {}
+
+            // State
+            bool HasValue() const noexcept
+            {
+                return !Error;
+            }
+            explicit operator bool() const noexcept
+            {
+                return HasValue();
+            }
+
+            // Throws the java exception if there is one
+            void GetValue() const
+            {
+                if (Error)
+                    throw Error;
+            }
+
+            // Exception (empty on success)
+            const JavaException& GetError() const noexcept
+            {
+                return Error;
+            }
+
+        private:
+            JavaException Error;
+    };
+
+    // Runs JNI calls and returns their result or the exception they left pending
+    //   jni::Result<jint> Size = jni::Try(Env, [&]() { return Env->CallIntMethod(List, Size); });
+    template<typename F>
+    inline Result<std::invoke_result_t<F>> Try(::JNIEnv* Env, F&& Body)
+    {
+        using R = std::invoke_result_t<F>;
+        if constexpr (std::is_void_v<R>)
+        {
+            Body();
+            return TakeException(Env);
+        }
+        else
+        {
+            R Value = Body();
+            if (Env->ExceptionCheck())
+                return TakeException(Env);
+            return Result<R>(std::move(Value));
+        }
+    }
+    // Runs JNI calls and throws the exception they left pending as jni::JavaException
+    template<typename F>
+    inline std::invoke_result_t<F> Checked(::JNIEnv* Env, F&& Body)
+    {
+        if constexpr (std::is_void_v<std::invoke_result_t<F>>)
+        {
+            Body();
+            ThrowPendingException(Env);
+        }
+        else
+        {
+            std::invoke_result_t<F> Value = Body();
+            ThrowPendingException(Env);
+            return Value;
+        }
+    }
+
+    // Checked calls of the cached method handles (a failed resolve is reported as the pending NoSuchMethodError)
+    template<typename R, typename... Args>
+    inline Result<R> Method<R(Args...)>::Try(::JNIEnv* Env, jobject Instance, Args... Arguments)
+    {
+        return jni::Try(Env, [&]() { return (*this)(Env, Instance, Arguments...); });
+    }
+    template<typename R, typename... Args>
+    inline R Method<R(Args...)>::Checked(::JNIEnv* Env, jobject Instance, Args... Arguments)
+    {
+        return jni::Checked(Env, [&]() { return (*this)(Env, Instance, Arguments...); });
+    }
+    template<typename R, typename... Args>
+    inline Result<R> StaticMethod<R(Args...)>::Try(::JNIEnv* Env, Args... Arguments)
+    {
+        return jni::Try(Env, [&]() { return (*this)(Env, Arguments...); });
+    }
+    template<typename R, typename... Args>
+    inline R StaticMethod<R(Args...)>::Checked(::JNIEnv* Env, Args... Arguments)
+    {
+        return jni::Checked(Env, [&]() { return (*this)(Env, Arguments...); });
+    }
+
+    // Translates the C++ exception being handled into a pending java exception (call from a catch block only)
+    inline void ThrowToJava(::JNIEnv* Env) noexcept
+    {
+        const char* Message = "Unknown C++ exception";
+        try
+        {
+            throw;
+        }
+        catch (const JavaException& Error)
+        {
+            if (Error)
+            {
+                Error.Throw(Env);
+                return;
+            }
+        }
+        catch (const std::exception& Error)
+        {
+            Message = Error.what();
+        }
+        catch (...)
+        {
+        }
+
+        jclass JAVA_Class = Env->FindClass("java/lang/RuntimeException");
+        if (JAVA_Class)
+        {
+            Env->ThrowNew(JAVA_Class, Message);
+            Env->DeleteLocalRef(JAVA_Class);
+        }
+    }
+
+    // Conversion of a java argument to the C++ parameter type of a native function (JavaType is what java passes)
+    template<typename T>
+    struct NativeArg
+    {
+        static_assert(IsObjectType<T>::value || std::is_arithmetic_v<T>, "Unsupported native parameter type");
+        using JavaType = T;
+
+        NativeArg(::JNIEnv*, JavaType Value) noexcept :
+            Value(Value)
+        {}
+        T Get() noexcept
+        {
+            return Value;
+        }
+
+        T Value;
+    };
+    template<>
+    struct NativeArg<bool>
+    {
+        using JavaType = jboolean;
+
+        NativeArg(::JNIEnv*, JavaType Value) noexcept :
+            Value(Value != JNI_FALSE)
+        {}
+        bool Get() noexcept
+        {
+            return Value;
+        }
+
+        bool Value;
+    };
+    template<>
+    struct NativeArg<std::string_view>
+    {
+        using JavaType = jstring;
+
+        // Converted into a pooled scratch buffer
+        NativeArg(::JNIEnv* Env, JavaType Value) :
+            String(Env, Value)
+        {}
+        std::string_view Get() noexcept
+        {
+            return String.View();
+        }
+
+        StringView String;
+    };
+    template<>
+    struct NativeArg<const std::string&>
+    {
+        using JavaType = jstring;
+
+        NativeArg(::JNIEnv* Env, JavaType Value) :
+            String(StringView(Env, Value).View())
+        {}
+        const std::string& Get() noexcept
+        {
+            return String;
+        }
+
+        std::string String;
+    };
+    template<>
+    struct NativeArg<std::string> : NativeArg<const std::string&>
+    {
+        using NativeArg<const std::string&>::NativeArg;
+
+        // Moved into the by value parameter
+        std::string&& Get() noexcept
+        {
+            return std::move(String);
+        }
+    };
+    template<typename T, size_t Extent>
+    struct NativeArg<std::span<T, Extent>>
+    {
+        static_assert(Extent == std::dynamic_extent, "Only dynamic spans can be mapped to java arrays");
+        using Element = std::remove_const_t<T>;
+        using JavaType = typename PrimitiveArrayTraits<Element>::ArrayType;
+
+        // Pinned / copied elements (span<const T> discards changes, span<T> commits them)
+        NativeArg(::JNIEnv* Env, JavaType Value) noexcept :
+            View(Env, Value, std::is_const_v<T> ? ReleaseMode::Abort : ReleaseMode::Commit)
+        {}
+        std::span<T> Get() noexcept
+        {
+            return View.Span();
+        }
+
+        ArrayView<Element> View;
+    };
+
+    // Conversion of a C++ return value to java
+    template<typename T>
+    struct NativeResult
+    {
+        static_assert(IsObjectType<T>::value || std::is_arithmetic_v<T>, "Unsupported native return type");
+        using JavaType = T;
+
+        static JavaType Convert(::JNIEnv*, T Value) noexcept
+        {
+            return Value;
+        }
+    };
+    template<>
+    struct NativeResult<void>
+    {
+        using JavaType = void;
+    };
+    template<>
+    struct NativeResult<bool>
+    {
+        using JavaType = jboolean;
+
+        static JavaType Convert(::JNIEnv*, bool Value) noexcept
+        {
+            return Value ? JNI_TRUE : JNI_FALSE;
+        }
+    };
+    template<>
+    struct NativeResult<std::string_view>
+    {
+        using JavaType = jstring;
+
+        static JavaType Convert(::JNIEnv* Env, std::string_view Value)
+        {
+            return NewString(Env, Value);
+        }
+    };
+    template<>
+    struct NativeResult<std::string> : NativeResult<std::string_view> {};
+    template<FixedString ClassName>
+    struct NativeResult<Object<ClassName>>
+    {
+        using JavaType = Object<ClassName>;
+
+        static jobject Convert(::JNIEnv*, Object<ClassName> Value) noexcept
+        {
+            return Value.Ref;
+        }
+    };
+
+    // Type of the raw JNI function (Object<...> is passed as jobject)
+    template<typename T>
+    using NativeABIType = std::conditional_t<IsObjectType<T>::value && !std::is_pointer_v<T>, jobject, T>;
+
+    // Generated JNI entry points for free (Function) and member (Method) functions
+    // A leading JNIEnv* parameter receives the env, member functions get their object as first java argument (long)
+    template<auto Function, typename R, bool PassEnv, typename... Params>
+    struct NativeTrampolineImpl
+    {
+        using ReturnType = NativeABIType<typename NativeResult<R>::JavaType>;
+
+        // Descriptor of the java side declaration
+        static constexpr auto Descriptor = MethodSignature<typename NativeResult<R>::JavaType(typename NativeArg<Params>::JavaType...)>::Value;
+
+        // JNI function (converters are temporaries that live until the call returned, C++ exceptions are thrown into java)
+        static ReturnType JNICALL Invoke(::JNIEnv* Env, jobject, NativeABIType<typename NativeArg<Params>::JavaType>... Values)
+        {
+            try
+            {
+                return Forward(Env, NativeArg<Params>(Env, Values)...);
+            }
+            catch (...)
+            {
+                ThrowToJava(Env);
+                return ReturnType();
+            }
+        }
+
+        private:
+            static ReturnType Forward(::JNIEnv* Env, NativeArg<Params>&&... Args)
+            {
+                if constexpr (std::is_void_v<R>)
+                {
+                    if constexpr (PassEnv)
+                        Function(Env, Args.Get()...);
+                    else
+                        Function(Args.Get()...);
+                }
+                else
+                {
+                    if constexpr (PassEnv)
+                        return NativeResult<R>::Convert(Env, Function(Env, Args.Get()...));
+                    else
+                        return NativeResult<R>::Convert(Env, Function(Args.Get()...));
+                }
+            }
+    };
+    template<auto Method, typename Class, typename R, bool PassEnv, typename... Params>
+    struct NativeMemberTrampolineImpl
+    {
+        using ReturnType = NativeABIType<typename NativeResult<R>::JavaType>;
+
+        // Descriptor of the java side declaration (first argument is the native instance)
+        static constexpr auto Descriptor = MethodSignature<typename NativeResult<R>::JavaType(jlong, typename NativeArg<Params>::JavaType...)>::Value;
+
+        // JNI function (converters are temporaries that live until the call returned, C++ exceptions are thrown into java)
+        static ReturnType JNICALL Invoke(::JNIEnv* Env, jobject, jlong Instance, NativeABIType<typename NativeArg<Params>::JavaType>... Values)
+        {
+            try
+            {
+                return Forward(Env, (Class*)Instance, NativeArg<Params>(Env, Values)...);
+            }
+            catch (...)
+            {
+                ThrowToJava(Env);
+                return ReturnType();
+            }
+        }
+
+        private:
+            static ReturnType Forward(::JNIEnv* Env, Class* Object, NativeArg<Params>&&... Args)
+            {
+                if constexpr (std::is_void_v<R>)
+                {
+                    if constexpr (PassEnv)
+                        (Object->*Method)(Env, Args.Get()...);
+                    else
+                        (Object->*Method)(Args.Get()...);
+                }
+                else
+                {
+                    if constexpr (PassEnv)
+                        return NativeResult<R>::Convert(Env, (Object->*Method)(Env, Args.Get()...));
+                    else
+                        return NativeResult<R>::Convert(Env, (Object->*Method)(Args.Get()...));
+                }
+            }
+    };
+
+    // Detects the optional leading JNIEnv*
+    template<auto Function, typename R, typename... Params>
+    struct NativeFreeSelect : NativeTrampolineImpl<Function, R, false, Params...> {};
+    template<auto Function, typename R, typename... Params>
+    struct NativeFreeSelect<Function, R, ::JNIEnv*, Params...> : NativeTrampolineImpl<Function, R, true, Params...> {};
+    template<auto Method, typename Class, typename R, typename... Params>
+    struct NativeMemberSelect : NativeMemberTrampolineImpl<Method, Class, R, false, Params...> {};
+    template<auto Method, typename Class, typename R, typename... Params>
+    struct NativeMemberSelect<Method, Class, R, ::JNIEnv*, Params...> : NativeMemberTrampolineImpl<Method, Class, R, true, Params...> {};
+
+    // Selects the trampoline for a function pointer
+    template<auto Function>
+    struct NativeTrampoline;
+    template<typename R, typename... Params, R(*Function)(Params...)>
+    struct NativeTrampoline<Function> : NativeFreeSelect<Function, R, Params...> {};
+    template<typename Class, typename R, typename... Params, R(Class::*Method)(Params...)>
+    struct NativeTrampoline<Method> : NativeMemberSelect<Method, Class, R, Params...> {};
+    template<typename Class, typename R, typename... Params, R(Class::*Method)(Params...) const>
+    struct NativeTrampoline<Method> : NativeMemberSelect<Method, const Class, R, Params...> {};
+
+    // Collects natives of one class and registers them with a single RegisterNatives call
+    //   jni::NativeMethods Natives("com/foo/Bar");
+    //   Natives.Add<&Sum>("Sum");               // static native int Sum(int[] values);
+    //   Natives.Add<&Engine::Tick>("Tick");     // static native void Tick(long engine, double dt);
+    //   Natives.Register(Env);
+    class NativeMethods
+    {
+        public:
+            // Construct for a class name ("com/foo/Bar") or an already resolved class
+            explicit NativeMethods(const char* ClassName) :
+                ClassName(ClassName)
+            {}
+            explicit NativeMethods(jclass Class) noexcept :
+                Class(Class)
+            {}
+
+            // Add a generated trampoline (signature is derived from the C++ function)
+            template<auto Function>
+            NativeMethods& Add(const char* Name)
+            {
+                using Trampoline = NativeTrampoline<Function>;
+                return Add(Name, Trampoline::Descriptor.CStr(), (void*)&Trampoline::Invoke);
+            }
+
+            // Add a hand written JNI function
+            NativeMethods& Add(const char* Name, const char* Signature, void* Function)
+            {
+                Names.emplace_back(Name);
+                Methods.push_back({ (char*)Names.back().c_str(), (char*)Signature, Function });
+                return *this;
+            }
+
+            // Register all methods (Returns true on success)
+            bool Register(::JNIEnv* Env) const
+            {
+                jclass Target = Class;
+                if (!Target && !ClassName.empty())
+                    Target = Env->FindClass(ClassName.c_str());
+
+                bool Ok = Target && Env->RegisterNatives(Target, Methods.data(), (jint)Methods.size()) == JNI_OK;
+                if (Target && Target != Class)
+                    Env->DeleteLocalRef(Target);
+
+                return Ok;
+            }
+
+            // Number of methods
+            size_t Size() const noexcept
+            {
+                return Methods.size();
+            }
+
+        private:
+            std::string ClassName;
+            jclass Class = nullptr;
+
+            // Stable name storage and method table
+            std::deque<std::string> Names;
+            std::vector<JNINativeMethod> Methods;
+    };
+
+    // Class and type of a pointer to data member
+    template<typename T>
+    struct DataMemberTraits;
+    template<typename C, typename T>
+    struct DataMemberTraits<T C::*>
+    {
+        using Class = C;
+        using Type = T;
+    };
+
+    // Start of the column that follows a column of Count * Size bytes (must match Marshaller.java)
+    constexpr size_t NextColumn(size_t Column, size_t Size, size_t Count) noexcept
+    {
+        return (Column + Size * Count + 63) & ~(size_t)63;
+    }
+
+    // Struct of arrays filled by StructMapping::ReadColumns (one 64 byte aligned column per mapped field)
+    template<typename Struct>
+    class StructColumns
+    {
+        public:
+            // Construct empty
+            StructColumns() = default;
+            // Construct zeroed columns for Count objects (MemberOffsets / Sizes in mapping order)
+            StructColumns(size_t Count, std::vector<size_t> MemberOffsets, const std::vector<size_t>& Sizes) :
+                Count(Count), MemberOffsets(std::move(MemberOffsets))
+            {
+                size_t Column = 0;
+                for (size_t Size : Sizes)
+                {
+                    ColumnStarts.push_back(Column);
+                    Column = NextColumn(Column, Size, Count);
+                }
+                Bytes = Column;
+                Storage = std::make_unique<uint8_t[]>(Bytes + 63);
+                Base = (uint8_t*)(((uintptr_t)Storage.get() + 63) & ~(uintptr_t)63);
+                std::memset(Base, 0, Bytes);
+            }
+
+            // Column of a mapped member (empty if the member is not mapped)
+            template<auto Member>
+            std::span<typename DataMemberTraits<decltype(Member)>::Type> Column() noexcept
+            {
+                using FieldType = typename DataMemberTraits<decltype(Member)>::Type;
+                size_t Index = IndexOf(MemberOffset<Member>());
+                return Index < ColumnStarts.size() ? std::span<FieldType>((FieldType*)(Base + ColumnStarts[Index]), Count) : std::span<FieldType>();
+            }
+            template<auto Member>
+            std::span<const typename DataMemberTraits<decltype(Member)>::Type> Column() const noexcept
+            {
+                return const_cast<StructColumns*>(this)->template Column<Member>();
+            }
+
+            // Object count
+            size_t Size() const noexcept
+            {
+                return Count;
+            }
+            // Raw storage (what java reads / writes)
+            uint8_t* GetData() const noexcept
+            {
+                return Base;
+            }
+            size_t GetSize() const noexcept
+            {
+                return Bytes;
+            }
+
+            // Byte offset of a member in Struct
+            template<auto Member>
+            static size_t MemberOffset() noexcept
+            {
+                static const size_t Offset = []()
+                {
+                    Struct Sample{};
+                    return (size_t)((const uint8_t*)&(Sample.*Member) - (const uint8_t*)&Sample);
+                }();
+                return Offset;
+            }
+
+        private:
+            size_t IndexOf(size_t Offset) const noexcept
+            {
+                return (size_t)(std::find(MemberOffsets.begin(), MemberOffsets.end(), Offset) - MemberOffsets.begin());
+            }
+
+        private:
+            size_t Count = 0;
+            size_t Bytes = 0;
+            std::vector<size_t> MemberOffsets;
+            std::vector<size_t> ColumnStarts;
+            std::unique_ptr<uint8_t[]> Storage;
+            uint8_t* Base = nullptr;
+    };
+
+    // Declarative mapping of primitive java fields to a C++ struct, copied for a whole Object[] with one java call
+    //   struct Point { jint X; jdouble Y; };
+    //   jni::StructMapping<Point> Points("com/foo/Point");
+    //   Points.Add<&Point::X>("x").Add<&Point::Y>("y");
+    //   std::vector<Point> Rows = Points.Read(Env, JAVA_Points);                  // array of structs
+    //   jni::StructColumns<Point> Columns = Points.ReadColumns(Env, JAVA_Points); // struct of arrays
+    //   Points.Write(Env, JAVA_Points, Rows);
+    // Java (com.fuechsl.jnihpp.Marshaller) writes straight into the C++ memory through a direct ByteBuffer
+    template<typename Struct>
+    class StructMapping
+    {
+        static_assert(std::is_trivially_copyable_v<Struct> && std::is_default_constructible_v<Struct>, "Struct has to be a trivially copyable and default constructible type");
+
+        public:
+            // Construct (ClassName as for FindClass: "com/foo/Bar")
+            explicit StructMapping(const char* ClassName) :
+                ClassName(ClassName)
+            {}
+            StructMapping(const StructMapping&) = delete;
+            StructMapping& operator=(const StructMapping&) = delete;
+
+            // Maps a member to a field of the same primitive type (only before the first Resolve)
+            template<auto Member>
+            StructMapping& Add(const char* FieldName)
+            {
+                using Traits = DataMemberTraits<decltype(Member)>;
+                static_assert(std::is_same_v<typename Traits::Class, Struct>, "Member does not belong to Struct");
+                static_assert(std::is_arithmetic_v<typename Traits::Type>, "Only primitive java types can be mapped");
+
+                Names.emplace_back(FieldName);
+                Descriptors += TypeSignature<typename Traits::Type>::Value.Value[0];
+                Offsets.push_back(StructColumns<Struct>::template MemberOffset<Member>());
+                Sizes.push_back(sizeof(typename Traits::Type));
+                return *this;
+            }
+
+            // Resolves the class and its fields once (thread safe, false when a field is missing or has another type)
+            // Failures leave no exception pending (Read / Write return 0 then)
+            bool Resolve(::JNIEnv* Env)
+            {
+                if (Resolved.load(std::memory_order_acquire))
+                    return true;
+
+                std::lock_guard<std::mutex> Lock(Mutex);
+                if (!Resolved.load(std::memory_order_relaxed))
+                {
+                    LocalFrame Frame(Env, 8);
+                    jclass JAVA_Class = Frame ? Env->FindClass(ClassName) : nullptr;
+                    jclass JAVA_Marshaller = JAVA_Class ? Env->FindClass("com/fuechsl/jnihpp/Marshaller") : nullptr;
+                    jmethodID JAVA_Create = JAVA_Marshaller ? Env->GetStaticMethodID(JAVA_Marshaller, "Create", "(Ljava/lang/Class;[Ljava/lang/String;Ljava/lang/String;[II)Lcom/fuechsl/jnihpp/Marshaller;") : nullptr;
+                    if (JAVA_Create)
+                    {
+                        Pack = Env->GetMethodID(JAVA_Marshaller, "Pack", "([Ljava/lang/Object;IILjava/nio/ByteBuffer;Z)I");
+                        Unpack = Env->GetMethodID(JAVA_Marshaller, "Unpack", "([Ljava/lang/Object;IILjava/nio/ByteBuffer;Z)I");
+
+                        jclass JAVA_String = Env->FindClass("java/lang/String");
+                        jobjectArray JAVA_Names = JAVA_String ? Env->NewObjectArray((jsize)Names.size(), JAVA_String, nullptr) : nullptr;
+                        jintArray JAVA_Offsets = Env->NewIntArray((jsize)Offsets.size());
+                        jstring JAVA_Descriptors = NewString(Env, Descriptors);
+                        if (JAVA_Names && JAVA_Offsets && JAVA_Descriptors && Pack && Unpack)
+                        {
+                            for (size_t i = 0; i < Names.size(); i++)
+                            {
+                                jstring JAVA_Name = NewString(Env, Names[i]);
+                                Env->SetObjectArrayElement(JAVA_Names, (jsize)i, JAVA_Name);
+                                Env->DeleteLocalRef(JAVA_Name);
+                            }
+                            for (size_t i = 0; i < Offsets.size(); i++)
+                            {
+                                jint Offset = (jint)Offsets[i];
+                                Env->SetIntArrayRegion(JAVA_Offsets, (jsize)i, 1, &Offset);
+                            }
+
+                            jobject JAVA_Instance = Env->CallStaticObjectMethod(JAVA_Marshaller, JAVA_Create, JAVA_Class, JAVA_Names, JAVA_Descriptors, JAVA_Offsets, (jint)sizeof(Struct));
+                            if (JAVA_Instance)
+                            {
+                                Marshaller = Global<jobject>(Env, JAVA_Instance);
+                                Resolved.store((bool)Marshaller, std::memory_order_release);
+                            }
+                        }
+                    }
+
+                    // NoClassDefFoundError / NoSuchMethodError of a failed resolve
+                    if (!Resolved.load(std::memory_order_relaxed))
+                    {
+                        Env->ExceptionClear();
+                    }
+                }
+
+                return Resolved.load(std::memory_order_relaxed);
+            }
+
+            // Copies Objects[Start, Start + Out.size()) into Out (returns the number of objects copied, null objects read as zero)
+            size_t Read(::JNIEnv* Env, jobjectArray Objects, std::span<Struct> Out, jsize Start = 0)
+            {
+                size_t Count = Clamp(Env, Objects, Start, Out.size());
+                return Count ? Transfer(Env, Pack, Objects, Start, Count, Out.data(), Count * sizeof(Struct), false) : 0;
+            }
+            std::vector<Struct> Read(::JNIEnv* Env, jobjectArray Objects)
+            {
+                std::vector<Struct> Out(Objects ? (size_t)Env->GetArrayLength(Objects) : 0);
+                Out.resize(Read(Env, Objects, std::span<Struct>(Out)));
+                return Out;
+            }
+            // Copies In back into Objects[Start, ...) (null objects are skipped)
+            size_t Write(::JNIEnv* Env, jobjectArray Objects, std::span<const Struct> In, jsize Start = 0)
+            {
+                size_t Count = Clamp(Env, Objects, Start, In.size());
+                return Count ? Transfer(Env, Unpack, Objects, Start, Count, (void*)In.data(), Count * sizeof(Struct), false) : 0;
+            }
+
+            // Copies all Objects into one column per mapped field
+            StructColumns<Struct> ReadColumns(::JNIEnv* Env, jobjectArray Objects)
+            {
+                size_t Count = Clamp(Env, Objects, 0, SIZE_MAX);
+                StructColumns<Struct> Columns(Count, Offsets, Sizes);
+                if (Count && Transfer(Env, Pack, Objects, 0, Count, Columns.GetData(), Columns.GetSize(), true) != Count)
+                {
+                    Columns = StructColumns<Struct>();
+                }
+                return Columns;
+            }
+            // Copies columns back into Objects[Start, Start + In.Size())
+            size_t WriteColumns(::JNIEnv* Env, jobjectArray Objects, const StructColumns<Struct>& In, jsize Start = 0)
+            {
+                size_t Count = Clamp(Env, Objects, Start, In.Size());
+                return Count == In.Size() && Count ? Transfer(Env, Unpack, Objects, Start, Count, In.GetData(), In.GetSize(), true) : 0;
+            }
+
+        private:
+            // Objects available from Start (at most Max)
+            size_t Clamp(::JNIEnv* Env, jobjectArray Objects, jsize Start, size_t Max)
+            {
+                jsize Length = Objects ? Env->GetArrayLength(Objects) : 0;
+                return Start >= 0 && Start < Length ? std::min<size_t>((size_t)(Length - Start), Max) : 0;
+            }
+            // One java call over a direct buffer on Data
+            size_t Transfer(::JNIEnv* Env, jmethodID Method, jobjectArray Objects, jsize Start, size_t Count, void* Data, size_t Bytes, bool Columns)
+            {
+                jint Done = -1;
+                if (Resolve(Env) && Count <= 0x7FFFFFFF)
+                {
+                    jobject JAVA_Buffer = Env->NewDirectByteBuffer(Data, (jlong)Bytes);
+                    if (JAVA_Buffer)
+                    {
+                        Done = Env->CallIntMethod(Marshaller.Get(), Method, Objects, Start, (jint)Count, JAVA_Buffer, (jboolean)Columns);
+                        Env->DeleteLocalRef(JAVA_Buffer);
+                    }
+                    if (Env->ExceptionCheck())
+                    {
+                        Env->ExceptionClear();
+                        Done = -1;
+                    }
+                }
+                return Done > 0 ? (size_t)Done : 0;
+            }
+
+        private:
+            const char* ClassName;
+
+            // Layout in mapping order
+            std::vector<std::string> Names;
+            std::string Descriptors;
+            std::vector<size_t> Offsets;
+            std::vector<size_t> Sizes;
+
+            // Resolved java helper (the global ref is released through the GlobalRefPool)
+            std::mutex Mutex;
+            Global<jobject> Marshaller;
+            std::atomic<bool> Resolved = false;
+            jmethodID Pack = nullptr;
+            jmethodID Unpack = nullptr;
+    };
+
+    // Instrumented Java <-> C++ boundaries
+    enum class Probe : size_t
+    {
+        StdOut,
+        StdErr,
+        Read,
+        Available,
+        DefineClass,
+        LoadResource,
+        LoadClass,
+        Count,
+    };
+
+    // Printable probe name
+    constexpr const char* ProbeName(Probe Id) noexcept
+    {
+        switch (Id)
+        {
+            case Probe::StdOut: return "NStdOut";
+            case Probe::StdErr: return "NStdErr";
+            case Probe::Read: return "NRead";
+            case Probe::Available: return "NAvailable";
+            case Probe::DefineClass: return "NDefineClass";
+            case Probe::LoadResource: return "NLoadResource";
+            case Probe::LoadClass: return "LoadClass";
+            default: return "Unknown";
+        }
+    }
+
+    // Aggregated counters of one probe
+    struct ProbeStats
+    {
+        // Latency buckets: bucket i counts calls of [2^i, 2^(i+1)) nanoseconds
+        static constexpr size_t BucketCount = 32;
+
+        uint64_t Calls = 0;
+        uint64_t Bytes = 0;
+        uint64_t TotalNanoseconds = 0;
+        uint64_t MaxNanoseconds = 0;
+        uint64_t Hits = 0;
+        uint64_t Misses = 0;
+        uint64_t Histogram[BucketCount] = {};
+
+        // Average latency
+        double MeanNanoseconds() const noexcept
+        {
+            return Calls ? (double)TotalNanoseconds / (double)Calls : 0.0;
+        }
+        // Upper bound of the bucket that contains the percentile (0.0 - 1.0)
+        uint64_t PercentileNanoseconds(double Percentile) const noexcept
+        {
+            uint64_t Target = (uint64_t)(Percentile * (double)Calls);
+            uint64_t Seen = 0;
+            for (size_t i = 0; i < BucketCount; i++)
+            {
+                Seen += Histogram[i];
+                if (Seen > Target)
+                    return std::min<uint64_t>((uint64_t)2 << i, MaxNanoseconds);
+            }
+            return MaxNanoseconds;
+        }
+    };
+
+    // Load time of one class (summed over all threads)
+    struct ClassLoadStats
+    {
+        std::string Name;
+        Probe Source = Probe::DefineClass;
+        uint64_t Count = 0;
+        uint64_t TotalNanoseconds = 0;
+        uint64_t MaxNanoseconds = 0;
+    };
+
+    // Point in time copy of all counters
+    struct InstrumentationSnapshot
+    {
+        ProbeStats Probes[(size_t)Probe::Count];
+        std::vector<ClassLoadStats> ClassLoads;
+        size_t Threads = 0;
+
+        // Access by probe
+        const ProbeStats& operator[](Probe Id) const noexcept
+        {
+            return Probes[(size_t)Id];
+        }
+
+        // JSON document { "threads": N, "probes": { ... }, "class_loads": [ ... ] }
+        std::string ToJson() const;
+    };
+
+    // Opt-in instrumentation of the jni-hpp callbacks (define JNIHPP_INSTRUMENTATION=1 to compile the probes in)
+    // Every thread owns a block of counters that only it writes (relaxed, no locked instructions)
+    // Readers sum all blocks, blocks of exited threads are kept so nothing is lost
+    class Instrumentation
+    {
+        public:
+            using Clock = std::chrono::steady_clock;
+
+            // True when the probes are compiled in
+            static constexpr bool Enabled = JNIHPP_INSTRUMENTATION != 0;
+
+            // Sums the counters of all threads
+            static InstrumentationSnapshot Capture()
+            {
+                Instrumentation& Self = Instance();
+                std::lock_guard<std::mutex> Lock(Self.Mutex);
+
+                InstrumentationSnapshot Snapshot;
+                Snapshot.Threads = Self.Blocks.size();
+                std::vector<ClassLoadStats> Loads;
+                for (const std::unique_ptr<ThreadBlock>& Block : Self.Blocks)
+                {
+                    for (size_t p = 0; p < (size_t)Probe::Count; p++)
+                    {
+                        const ThreadCounters& From = Block->Counters[p];
+                        ProbeStats& To = Snapshot.Probes[p];
+                        To.Calls += From.Calls.load(std::memory_order_relaxed);
+                        To.Bytes += From.Bytes.load(std::memory_order_relaxed);
+                        To.TotalNanoseconds += From.TotalNanoseconds.load(std::memory_order_relaxed);
+                        To.MaxNanoseconds = std::max(To.MaxNanoseconds, From.MaxNanoseconds.load(std::memory_order_relaxed));
+                        To.Hits += From.Hits.load(std::memory_order_relaxed);
+                        To.Misses += From.Misses.load(std::memory_order_relaxed);
+                        for (size_t b = 0; b < ProbeStats::BucketCount; b++)
+                        {
+                            To.Histogram[b] += From.Histogram[b].load(std::memory_order_relaxed);
+                        }
+                    }
+
+                    std::lock_guard<std::mutex> BlockLock(Block->Mutex);
+                    Loads.insert(Loads.end(), Block->ClassLoads.begin(), Block->ClassLoads.end());
+                }
+
+                // Merge per class (slowest first)
+                std::sort(Loads.begin(), Loads.end(), [](const ClassLoadStats& A, const ClassLoadStats& B) { return A.Source != B.Source ? A.Source < B.Source : A.Name < B.Name; });
+                for (ClassLoadStats& Load : Loads)
+                {
+                    if (!Snapshot.ClassLoads.empty() && Snapshot.ClassLoads.back().Source == Load.Source && Snapshot.ClassLoads.back().Name == Load.Name)
+                    {
+                        ClassLoadStats& Merged = Snapshot.ClassLoads.back();
+                        Merged.Count += Load.Count;
+                        Merged.TotalNanoseconds += Load.TotalNanoseconds;
+                        Merged.MaxNanoseconds = std::max(Merged.MaxNanoseconds, Load.MaxNanoseconds);
+                    }
+                    else
+                    {
+                        Snapshot.ClassLoads.push_back(std::move(Load));
+                    }
+                }
+                std::sort(Snapshot.ClassLoads.begin(), Snapshot.ClassLoads.end(), [](const ClassLoadStats& A, const ClassLoadStats& B) { return A.TotalNanoseconds > B.TotalNanoseconds; });
+
+                return Snapshot;
+            }
+
+            // Zeroes all counters and drops trace events (calls racing with the reset may be lost)
+            static void Reset()
+            {
+                Instrumentation& Self = Instance();
+                std::lock_guard<std::mutex> Lock(Self.Mutex);
+                for (const std::unique_ptr<ThreadBlock>& Block : Self.Blocks)
+                {
+                    for (ThreadCounters& Counters : Block->Counters)
+                    {
+                        Counters.Calls.store(0, std::memory_order_relaxed);
+                        Counters.Bytes.store(0, std::memory_order_relaxed);
+                        Counters.TotalNanoseconds.store(0, std::memory_order_relaxed);
+                        Counters.MaxNanoseconds.store(0, std::memory_order_relaxed);
+                        Counters.Hits.store(0, std::memory_order_relaxed);
+                        Counters.Misses.store(0, std::memory_order_relaxed);
+                        for (std::atomic<uint64_t>& Bucket : Counters.Histogram)
+                        {
+                            Bucket.store(0, std::memory_order_relaxed);
+                        }
+                    }
+
+                    std::lock_guard<std::mutex> BlockLock(Block->Mutex);
+                    Block->ClassLoads.clear();
+                    Block->Events.clear();
+                }
+            }
+
+            // Records every probe call as trace event (at most MaxEventsPerThread per thread)
+            static void SetTracing(bool Enable, size_t MaxEventsPerThread = 65536) noexcept
+            {
+                Instrumentation& Self = Instance();
+                Self.MaxEvents.store(MaxEventsPerThread, std::memory_order_relaxed);
+                Self.Tracing.store(Enable, std::memory_order_relaxed);
+            }
+            static bool IsTracing() noexcept
+            {
+                return Instance().Tracing.load(std::memory_order_relaxed);
+            }
+
+            // Writes Capture().ToJson()
+            static bool WriteJson(const std::filesystem::path& Path)
+            {
+                std::ofstream Out(Path, std::ios::binary | std::ios::trunc);
+                Out << Capture().ToJson();
+                return (bool)Out;
+            }
+            // Writes the trace events in the chrome trace event format (chrome://tracing, perfetto)
+            static bool WriteChromeTrace(const std::filesystem::path& Path)
+            {
+                Instrumentation& Self = Instance();
+                std::string Json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+                bool First = true;
+                {
+                    std::lock_guard<std::mutex> Lock(Self.Mutex);
+                    for (const std::unique_ptr<ThreadBlock>& Block : Self.Blocks)
+                    {
+                        std::lock_guard<std::mutex> BlockLock(Block->Mutex);
+                        for (const TraceEvent& Event : Block->Events)
+                        {
+                            char Times[96];
+                            std::snprintf(Times, sizeof(Times), "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u", (double)Event.Start / 1000.0, (double)Event.Duration / 1000.0, Block->ThreadId);
+
+                            Json += First ? "{\"name\":\"" : ",{\"name\":\"";
+                            Json += ProbeName(Event.Id);
+                            Json += "\",\"cat\":\"jni\",\"ph\":\"X\",";
+                            Json += Times;
+                            if (!Event.Label.empty())
+                            {
+                                Json += ",\"args\":{\"name\":";
+                                AppendJsonString(Json, Event.Label);
+                                Json += "}";
+                            }
+                            Json += "}";
+                            First = false;
+                        }
+                    }
+                }
+                Json += "]}";
+
+                std::ofstream Out(Path, std::ios::binary | std::ios::trunc);
+                Out << Json;
+                return (bool)Out;
+            }
+
+            // Adds one probe call to the counters of the calling thread
+            static void Record(Probe Id, Clock::time_point Start, Clock::time_point End, uint64_t Bytes, int Hit, std::string_view Label) noexcept
+            {
+                // Runs inside JNI callbacks and destructors: a failed allocation drops the sample
+                try
+                {
+                    ThreadBlock& Block = Local();
+                    ThreadCounters& Counters = Block.Counters[(size_t)Id];
+                    uint64_t Nanoseconds = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(End - Start).count();
+
+                    // Owner only writes (no read-modify-write needed)
+                    Add(Counters.Calls, 1);
+                    Add(Counters.Bytes, Bytes);
+                    Add(Counters.TotalNanoseconds, Nanoseconds);
+                    if (Nanoseconds > Counters.MaxNanoseconds.load(std::memory_order_relaxed))
+                        Counters.MaxNanoseconds.store(Nanoseconds, std::memory_order_relaxed);
+                    if (Hit > 0)
+                        Add(Counters.Hits, 1);
+                    else if (Hit < 0)
+                        Add(Counters.Misses, 1);
+                    Add(Counters.Histogram[std::min<size_t>(Nanoseconds ? std::bit_width(Nanoseconds) - 1 : 0, ProbeStats::BucketCount - 1)], 1);
+
+                    // Class load time (rare, may lock)
+                    bool IsClassLoad = (Id == Probe::DefineClass || Id == Probe::LoadClass) && Hit <= 0 && !Label.empty();
+                    bool Trace = IsTracing();
+                    if (IsClassLoad || Trace)
+                    {
+                        std::lock_guard<std::mutex> Lock(Block.Mutex);
+                        if (IsClassLoad)
+                        {
+                            Block.ClassLoads.push_back({ std::string(Label), Id, 1, Nanoseconds, Nanoseconds });
+                        }
+                        if (Trace && Block.Events.size() < Instance().MaxEvents.load(std::memory_order_relaxed))
+                        {
+                            uint64_t Offset = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Start - Instance().Epoch).count();
+                            Block.Events.push_back({ Id, Offset, Nanoseconds, std::string(Label) });
+                        }
+                    }
+                }
+                catch (...)
+                {
+                }
+            }
+
+            // JSON string literal
+            static void AppendJsonString(std::string& Json, std::string_view Text)
+            {
+                Json += '"';
+                for (char c : Text)
+                {
+                    if (c == '"' || c == '\\')
+                    {
+                        Json += '\\';
+                        Json += c;
+                    }
+                    else if ((unsigned char)c < 0x20)
+                    {
+                        char Escaped[8];
+                        std::snprintf(Escaped, sizeof(Escaped), "\\u%04x", (unsigned)c);
+                        Json += Escaped;
+                    }
+                    else
+                    {
+                        Json += c;
+                    }
+                }
+                Json += '"';
+            }
+
+        private:
+            // Counters of one probe on one thread
+            struct ThreadCounters
+            {
+                std::atomic<uint64_t> Calls = 0;
+                std::atomic<uint64_t> Bytes = 0;
+                std::atomic<uint64_t> TotalNanoseconds = 0;
+                std::atomic<uint64_t> MaxNanoseconds = 0;
+                std::atomic<uint64_t> Hits = 0;
+                std::atomic<uint64_t> Misses = 0;
+                std::atomic<uint64_t> Histogram[ProbeStats::BucketCount] = {};
+            };
+            struct TraceEvent
+            {
+                Probe Id;
+                uint64_t Start;
+                uint64_t Duration;
+                std::string Label;
+            };
+            struct alignas(64) ThreadBlock
+            {
+                ThreadCounters Counters[(size_t)Probe::Count];
+                uint32_t ThreadId = 0;
+
+                // Guards the vectors (only contended while a reader copies them)
+                std::mutex Mutex;
+                std::vector<ClassLoadStats> ClassLoads;
+                std::vector<TraceEvent> Events;
+            };
+
+            Instrumentation() = default;
+
+            static Instrumentation& Instance()
+            {
+                static Instrumentation Self;
+                return Self;
+            }
+            // Counter block of the calling thread (registered on first use, never freed)
+            static ThreadBlock& Local()
+            {
+                static thread_local ThreadBlock* Block = nullptr;
+                if (!Block)
+                {
+                    Instrumentation& Self = Instance();
+                    std::lock_guard<std::mutex> Lock(Self.Mutex);
+                    Self.Blocks.push_back(std::make_unique<ThreadBlock>());
+                    Block = Self.Blocks.back().get();
+                    Block->ThreadId = (uint32_t)Self.Blocks.size();
+                }
+                return *Block;
+            }
+            static void Add(std::atomic<uint64_t>& Counter, uint64_t Value) noexcept
+            {
+                Counter.store(Counter.load(std::memory_order_relaxed) + Value, std::memory_order_relaxed);
+            }
+
+        private:
+            std::mutex Mutex;
+            std::vector<std::unique_ptr<ThreadBlock>> Blocks;
+            std::atomic<bool> Tracing = false;
+            std::atomic<size_t> MaxEvents = 65536;
+            Clock::time_point Epoch = Clock::now();
+    };
+
+    inline std::string InstrumentationSnapshot::ToJson() const
+    {
+        std::string Json = "{\"threads\":" + std::to_string(Threads) + ",\"probes\":{";
+        for (size_t p = 0; p < (size_t)Probe::Count; p++)
+        {
+            const ProbeStats& Stats = Probes[p];
+            Json += p ? ",\"" : "\"";
+            Json += ProbeName((Probe)p);
+            Json += "\":{\"calls\":" + std::to_string(Stats.Calls);
+            Json += ",\"bytes\":" + std::to_string(Stats.Bytes);
+            Json += ",\"total_ns\":" + std::to_string(Stats.TotalNanoseconds);
+            Json += ",\"max_ns\":" + std::to_string(Stats.MaxNanoseconds);
+            Json += ",\"p50_ns\":" + std::to_string(Stats.PercentileNanoseconds(0.5));
+            Json += ",\"p99_ns\":" + std::to_string(Stats.PercentileNanoseconds(0.99));
+            Json += ",\"hits\":" + std::to_string(Stats.Hits);
+            Json += ",\"misses\":" + std::to_string(Stats.Misses);
+            Json += ",\"histogram\":[";
+            for (size_t b = 0; b < ProbeStats::BucketCount; b++)
+            {
+                Json += (b ? "," : "") + std::to_string(Stats.Histogram[b]);
+            }
+            Json += "]}";
+        }
+        Json += "},\"class_loads\":[";
+        for (size_t i = 0; i < ClassLoads.size(); i++)
+        {
+            const ClassLoadStats& Load = ClassLoads[i];
+            Json += i ? ",{\"name\":" : "{\"name\":";
+            Instrumentation::AppendJsonString(Json, Load.Name);
+            Json += ",\"source\":\"";
+            Json += ProbeName(Load.Source);
+            Json += "\",\"count\":" + std::to_string(Load.Count);
+            Json += ",\"total_ns\":" + std::to_string(Load.TotalNanoseconds);
+            Json += ",\"max_ns\":" + std::to_string(Load.MaxNanoseconds) + "}";
+        }
+        Json += "]}";
+        return Json;
+    }
+
+    // Times one probe call (created by the __JNIHPP_PROBE macros only)
+    class ProbeScope
+    {
+        public:
+            explicit ProbeScope(Probe Id) noexcept :
+                Id(Id), Start(Instrumentation::Clock::now())
+            {}
+            ProbeScope(const ProbeScope&) = delete;
+            ProbeScope& operator=(const ProbeScope&) = delete;
+            ~ProbeScope()
+            {
+                Instrumentation::Record(Id, Start, Instrumentation::Clock::now(), Bytes, Hit, Label);
+            }
+
+            // Names the call (copied for class loads and trace events only)
+            void SetLabel(std::string_view Name)
+            {
+                if (Id == Probe::DefineClass || Id == Probe::LoadClass || Instrumentation::IsTracing())
+                    Label.assign(Name);
+            }
+
+            uint64_t Bytes = 0;
+            int Hit = 0;
+
+        private:
+            Probe Id;
+            Instrumentation::Clock::time_point Start;
+            std::string Label;
+    };
+
+    // Concurrent cache of class global refs resolved through the jni-hpp class loader
+    // "com/foo/Bar" and "com.foo.Bar" are the same key, lookups are lock free
+    // Each shard publishes an insert only open addressing table, growing copies it (old tables live until Clear)
+    class ClassCache
+    {
+        public:
+            // Number of independently locked shards
+            static constexpr size_t ShardCount = 16;
+
+            // Construct
+            ClassCache() = default;
+            ClassCache(const ClassCache&) = delete;
+            ClassCache& operator=(const ClassCache&) = delete;
+
+            // Sets the java resolver (called by JavaVM after startup)
+            void Bind(jclass LoaderClass, jclass StringClass, jmethodID LoadClass, jmethodID LoadClasses) noexcept
+            {
+                this->LoaderClass = LoaderClass;
+                this->StringClass = StringClass;
+                this->LoadClass = LoadClass;
+                this->LoadClasses = LoadClasses;
+            }
+
+            // Cached class (resolved and cached on first use, nullptr if the class does not exist)
+            jclass Get(::JNIEnv* Env, std::string_view Name)
+            {
+                __JNIHPP_PROBE(Timing, LoadClass);
+                uint64_t Hash = HashName(Name);
+                jclass Class = Find(Hash, Name);
+                __JNIHPP_PROBE_HIT(Timing, Class);
+                if (!Class && LoadClass)
+                {
+                    __JNIHPP_PROBE_LABEL(Timing, Name);
+                    // Resolve without holding a lock (loading can call back into C++)
+                    jstring JAVA_Name = NewString(Env, Name);
+                    if (JAVA_Name)
+                    {
+                        jclass JAVA_Class = (jclass)Env->CallStaticObjectMethod(LoaderClass, LoadClass, JAVA_Name);
+                        if (JAVA_Class)
+                        {
+                            Class = Insert(Env, Hash, Name, JAVA_Class);
+                            Env->DeleteLocalRef(JAVA_Class);
+                        }
+                        Env->DeleteLocalRef(JAVA_Name);
+                    }
+                }
+                return Class;
+            }
+            // Cached class without resolving
+            jclass Find(std::string_view Name) const noexcept
+            {
+                return Find(HashName(Name), Name);
+            }
+
+            // Resolves all names with a single java call (returns the number of classes found)
+            size_t Preload(::JNIEnv* Env, const std::vector<std::string>& Names)
+            {
+                size_t Found = 0;
+                if (LoadClasses && !Names.empty())
+                {
+                    LocalFrame Frame(Env, 4);
+                    jobjectArray JAVA_Names = Frame ? Env->NewObjectArray((jsize)Names.size(), StringClass, nullptr) : nullptr;
+                    if (JAVA_Names)
+                    {
+                        for (size_t i = 0; i < Names.size(); i++)
+                        {
+                            jstring JAVA_Name = NewString(Env, Names[i]);
+                            Env->SetObjectArrayElement(JAVA_Names, (jsize)i, JAVA_Name);
+                            Env->DeleteLocalRef(JAVA_Name);
+                        }
+
+                        jobjectArray JAVA_Classes = (jobjectArray)Env->CallStaticObjectMethod(LoaderClass, LoadClasses, JAVA_Names);
+                        if (JAVA_Classes)
+                        {
+                            for (size_t i = 0; i < Names.size(); i++)
+                            {
+                                jclass JAVA_Class = (jclass)Env->GetObjectArrayElement(JAVA_Classes, (jsize)i);
+                                if (JAVA_Class)
+                                {
+                                    Insert(Env, HashName(Names[i]), Names[i], JAVA_Class);
+                                    Env->DeleteLocalRef(JAVA_Class);
+                                    Found++;
+                                }
+                            }
+                        }
+                    }
+                }
+                return Found;
+            }
+
+            // Deletes all cached refs (no lookup may run concurrently)
+            void Clear(::JNIEnv* Env) noexcept
+            {
+                for (Shard& S : Shards)
+                {
+                    std::lock_guard<std::mutex> Lock(S.Mutex);
+                    Table* Current = S.Current.load(std::memory_order_relaxed);
+                    if (Current && Env)
+                    {
+                        for (size_t i = 0; i <= Current->Mask; i++)
+                        {
+                            if (Current->Entries[i].Class)
+                                Env->DeleteGlobalRef(Current->Entries[i].Class);
+                        }
+                    }
+                    S.Current.store(nullptr, std::memory_order_release);
+                    S.Tables.clear();
+                }
+            }
+
+            // Number of cached classes
+            size_t Size() const noexcept
+            {
+                size_t Count = 0;
+                for (const Shard& S : Shards)
+                {
+                    const Table* Current = S.Current.load(std::memory_order_acquire);
+                    Count += Current ? Current->Used.load(std::memory_order_relaxed) : 0;
+                }
+                return Count;
+            }
+
+        private:
+            // Slot (Hash is published last, 0 marks an empty slot)
+            struct Entry
+            {
+                std::atomic<uint64_t> Hash = 0;
+                std::string Name;
+                jclass Class = nullptr;
+            };
+            struct Table
+            {
+                size_t Mask = 0;
+                std::atomic<size_t> Used = 0;
+                std::unique_ptr<Entry[]> Entries;
+            };
+            struct Shard
+            {
+                std::mutex Mutex;
+                std::atomic<Table*> Current = nullptr;
+                std::vector<std::unique_ptr<Table>> Tables;
+            };
+
+            // Key helpers ('.' and '/' are equal)
+            static constexpr char Normalize(char c) noexcept
+            {
+                return c == '.' ? '/' : c;
+            }
+            static uint64_t HashName(std::string_view Name) noexcept
+            {
+                uint64_t Hash = ClassArchive::HashInit;
+                for (char c : Name)
+                {
+                    Hash = ClassArchive::HashStep(Hash, (unsigned char)Normalize(c));
+                }
+                return Hash ? Hash : 1;
+            }
+            static bool SameName(std::string_view Stored, std::string_view Name) noexcept
+            {
+                if (Stored.size() != Name.size())
+                    return false;
+                for (size_t i = 0; i < Name.size(); i++)
+                {
+                    if (Stored[i] != Normalize(Name[i]))
+                        return false;
+                }
+                return true;
+            }
+            Shard& ShardOf(uint64_t Hash) noexcept
+            {
+                return Shards[(Hash >> 56) % ShardCount];
+            }
+            const Shard& ShardOf(uint64_t Hash) const noexcept
+            {
+                return Shards[(Hash >> 56) % ShardCount];
+            }
+
+            // Lock free probe
+            static jclass Probe(const Table* Current, uint64_t Hash, std::string_view Name) noexcept
+            {
+                if (Current)
+                {
+                    for (size_t i = Hash & Current->Mask;; i = (i + 1) & Current->Mask)
+                    {
+                        uint64_t SlotHash = Current->Entries[i].Hash.load(std::memory_order_acquire);
+                        if (!SlotHash)
+                            break;
+                        if (SlotHash == Hash && SameName(Current->Entries[i].Name, Name))
+                            return Current->Entries[i].Class;
+                    }
+                }
+                return nullptr;
+            }
+            jclass Find(uint64_t Hash, std::string_view Name) const noexcept
+            {
+                return Probe(ShardOf(Hash).Current.load(std::memory_order_acquire), Hash, Name);
+            }
+
+            // Places an entry into a table with free slots (writer lock held)
+            static void Place(Table& Target, uint64_t Hash, std::string Name, jclass Class)
+            {
+                size_t i = Hash & Target.Mask;
+                while (Target.Entries[i].Hash.load(std::memory_order_relaxed))
+                {
+                    i = (i + 1) & Target.Mask;
+                }
+                Target.Entries[i].Name = std::move(Name);
+                Target.Entries[i].Class = Class;
+                Target.Entries[i].Hash.store(Hash, std::memory_order_release);
+                Target.Used.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Pins the class as global ref and publishes it (returns the cached ref if another thread was faster)
+            jclass Insert(::JNIEnv* Env, uint64_t Hash, std::string_view Name, jclass Class)
+            {
+                Shard& S = ShardOf(Hash);
+                std::lock_guard<std::mutex> Lock(S.Mutex);
+
+                Table* Current = S.Current.load(std::memory_order_relaxed);
+                if (jclass Cached = Probe(Current, Hash, Name))
+                {
+                    return Cached;
+                }
+
+                // Grow at 50% load (readers keep using the old table)
+                if (!Current || (Current->Used.load(std::memory_order_relaxed) + 1) * 2 > Current->Mask + 1)
+                {
+                    size_t Capacity = Current ? (Current->Mask + 1) * 2 : 64;
+                    std::unique_ptr<Table> Grown = std::make_unique<Table>();
+                    Grown->Mask = Capacity - 1;
+                    Grown->Entries = std::make_unique<Entry[]>(Capacity);
+                    if (Current)
+                    {
+                        for (size_t i = 0; i <= Current->Mask; i++)
+                        {
+                            const Entry& Old = Current->Entries[i];
+                            uint64_t OldHash = Old.Hash.load(std::memory_order_relaxed);
+                            if (OldHash)
+                                Place(*Grown, OldHash, Old.Name, Old.Class);
+                        }
+                    }
+                    Current = Grown.get();
+                    S.Tables.push_back(std::move(Grown));
+                }
+
+                // Stored in normalized form
+                std::string Stored(Name);
+                std::replace(Stored.begin(), Stored.end(), '.', '/');
+
+                jclass Global = (jclass)Env->NewGlobalRef(Class);
+                if (Global)
+                {
+                    Place(*Current, Hash, std::move(Stored), Global);
+                }
+                S.Current.store(Current, std::memory_order_release);
+                return Global;
+            }
+
+        private:
+            Shard Shards[ShardCount];
+            jclass LoaderClass = nullptr;
+            jclass StringClass = nullptr;
+            jmethodID LoadClass = nullptr;
+            jmethodID LoadClasses = nullptr;
+    };
+
+    // Field or method of a reflected class
+    struct ReflectedMember
+    {
+        std::string Name;
+        // JNI descriptor ("I", "Ljava/lang/String;", "(IJ)V")
+        std::string Descriptor;
+        // java.lang.reflect.Modifier flags
+        uint32_t Modifiers = 0;
+
+        bool IsStatic() const noexcept
+        {
+            return (Modifiers & 0x0008) != 0;
+        }
+    };
+
+    // Class metadata exported with a single call by com.fuechsl.jnihpp.reflection.ClassReflector.Export
+    // Big endian, strings are u16 length + modified UTF-8 (like in class files):
+    //   u32 Magic | u16 Version | u32 Modifiers | Name | SuperName | u16 n, Interfaces | u16 n, Fields | u16 n, Methods
+    //   Members are { u32 Modifiers; Name; Descriptor; }, constructors are methods named "<init>"
+    class ReflectedClass
+    {
+        public:
+            // Format (must match ClassReflector.java)
+            static constexpr uint32_t Magic = 0x4A52464C;
+            static constexpr uint16_t Version = 1;
+
+            // Construct
+            ReflectedClass() = default;
+
+            // Reads an export (false when the data is truncated or has another version)
+            bool Parse(std::span<const uint8_t> Export)
+            {
+                Reader In{ Export };
+                ReflectedClass Result;
+                bool Ok = In.U32() == Magic && In.U16() == Version;
+                Result.Modifiers = In.U32();
+                Result.Name = In.Utf();
+                Result.SuperName = In.Utf();
+                for (uint16_t i = 0, Count = In.U16(); Ok && i < Count; i++)
+                {
+                    Result.Interfaces.push_back(In.Utf());
+                }
+                Ok = Ok && In.Members(Result.Fields) && In.Members(Result.Methods) && In.Ok && !Result.Name.empty();
+
+                if (Ok)
+                {
+                    Result.Data.assign(Export.begin(), Export.end());
+                    *this = std::move(Result);
+                }
+                return Ok;
+            }
+
+            // Internal names ("com/foo/Bar", SuperName is empty for java/lang/Object and interfaces)
+            const std::string& GetName() const noexcept
+            {
+                return Name;
+            }
+            const std::string& GetSuperName() const noexcept
+            {
+                return SuperName;
+            }
+            const std::vector<std::string>& GetInterfaces() const noexcept
+            {
+                return Interfaces;
+            }
+            uint32_t GetModifiers() const noexcept
+            {
+                return Modifiers;
+            }
+
+            // Declared members
+            const std::vector<ReflectedMember>& GetFields() const noexcept
+            {
+                return Fields;
+            }
+            const std::vector<ReflectedMember>& GetMethods() const noexcept
+            {
+                return Methods;
+            }
+
+            // Lookup (an empty descriptor matches the first overload)
+            const ReflectedMember* FindField(std::string_view FieldName) const noexcept
+            {
+                return FindMember(Fields, FieldName, {});
+            }
+            const ReflectedMember* FindMethod(std::string_view MethodName, std::string_view MethodDescriptor = {}) const noexcept
+            {
+                return FindMember(Methods, MethodName, MethodDescriptor);
+            }
+
+            // Raw export (what the disk cache stores)
+            std::span<const uint8_t> GetData() const noexcept
+            {
+                return Data;
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return !Name.empty();
+            }
+
+        private:
+            // Bounds checked big endian reader (Ok turns false on the first overrun)
+            struct Reader
+            {
+                std::span<const uint8_t> Data;
+                size_t Offset = 0;
+                bool Ok = true;
+
+                bool Take(size_t Size) noexcept
+                {
+                    Ok = Ok && Data.size() - Offset >= Size;
+                    return Ok;
+                }
+                uint16_t U16() noexcept
+                {
+                    if (!Take(2))
+                        return 0;
+                    uint16_t Value = (uint16_t)((Data[Offset] << 8) | Data[Offset + 1]);
+                    Offset += 2;
+                    return Value;
+                }
+                uint32_t U32() noexcept
+                {
+                    uint32_t High = U16();
+                    return (High << 16) | U16();
+                }
+                std::string Utf()
+                {
+                    uint16_t Length = U16();
+                    if (!Take(Length))
+                        return std::string();
+                    std::string Value((const char*)Data.data() + Offset, Length);
+                    Offset += Length;
+                    return Value;
+                }
+                bool Members(std::vector<ReflectedMember>& Target)
+                {
+                    uint16_t Count = U16();
+                    Target.reserve(Count);
+                    for (uint16_t i = 0; Ok && i < Count; i++)
+                    {
+                        ReflectedMember Member;
+                        Member.Modifiers = U32();
+                        Member.Name = Utf();
+                        Member.Descriptor = Utf();
+                        Target.push_back(std::move(Member));
+                    }
+                    return Ok;
+                }
+            };
+
+            static const ReflectedMember* FindMember(const std::vector<ReflectedMember>& Members, std::string_view MemberName, std::string_view MemberDescriptor) noexcept
+            {
+                for (const ReflectedMember& Member : Members)
+                {
+                    if (Member.Name == MemberName && (MemberDescriptor.empty() || Member.Descriptor == MemberDescriptor))
+                        return &Member;
+                }
+                return nullptr;
+            }
+
+        private:
+            std::string Name;
+            std::string SuperName;
+            std::vector<std::string> Interfaces;
+            std::vector<ReflectedMember> Fields;
+            std::vector<ReflectedMember> Methods;
+            uint32_t Modifiers = 0;
+            std::vector<uint8_t> Data;
+    };
+
+    // Reflected classes by name, exported once per class and persisted as <Directory>/<class file hash>.jrfl
+    // A class whose file did not change is read from disk without any reflection
+    class ReflectionCache
+    {
+        public:
+            // Construct
+            ReflectionCache() = default;
+            ReflectionCache(const ReflectionCache&) = delete;
+            ReflectionCache& operator=(const ReflectionCache&) = delete;
+
+            // Sets the java exporter (called by JavaVM after startup)
+            void Bind(jclass ReflectorClass, jmethodID Export, jmethodID HashClass) noexcept
+            {
+                this->ReflectorClass = ReflectorClass;
+                this->Export = Export;
+                this->HashClass = HashClass;
+            }
+            // Enables the disk cache (empty path disables it)
+            void SetDirectory(const std::filesystem::path& Directory)
+            {
+                std::lock_guard<std::mutex> Lock(Mutex);
+                this->Directory = Directory;
+                if (!Directory.empty())
+                {
+                    std::error_code Error;
+                    std::filesystem::create_directories(Directory, Error);
+                }
+            }
+
+            // Metadata of a class ("com/foo/Bar" or "com.foo.Bar", nullptr if the class does not exist)
+            // Hash is the FNV-1a of the class file when the caller knows it (0 asks java to hash it)
+            std::shared_ptr<const ReflectedClass> Get(::JNIEnv* Env, std::string_view ClassName, uint64_t Hash = 0)
+            {
+                std::string Name(ClassName);
+                std::replace(Name.begin(), Name.end(), '.', '/');
+                std::shared_ptr<const ReflectedClass> Class = Find(Name);
+                if (Class || !Export)
+                    return Class;
+
+                // Disk first (no lock held while java runs)
+                std::filesystem::path File = CacheFile(Env, Name, Hash);
+                std::shared_ptr<ReflectedClass> Loaded = std::make_shared<ReflectedClass>();
+                bool Ok = !File.empty() && ReadFile(File, *Loaded) && Loaded->GetName() == Name;
+                if (!Ok)
+                {
+                    jstring JAVA_Name = NewString(Env, Name);
+                    jbyteArray JAVA_Export = JAVA_Name ? (jbyteArray)Env->CallStaticObjectMethod(ReflectorClass, Export, JAVA_Name) : nullptr;
+                    if (JAVA_Export)
+                    {
+                        std::vector<uint8_t> Bytes((size_t)Env->GetArrayLength(JAVA_Export));
+                        Env->GetByteArrayRegion(JAVA_Export, 0, (jsize)Bytes.size(), (jbyte*)Bytes.data());
+                        Ok = Loaded->Parse(Bytes);
+                        if (Ok && !File.empty())
+                        {
+                            WriteFile(File, Loaded->GetData());
+                        }
+                        Env->DeleteLocalRef(JAVA_Export);
+                    }
+                    if (JAVA_Name)
+                    {
+                        Env->DeleteLocalRef(JAVA_Name);
+                    }
+                }
+                if (!Ok)
+                {
+                    return nullptr;
+                }
+
+                std::lock_guard<std::mutex> Lock(Mutex);
+                std::shared_ptr<const ReflectedClass>& Slot = Classes[Name];
+                if (!Slot)
+                {
+                    Slot = std::move(Loaded);
+                }
+                return Slot;
+            }
+            // Metadata without exporting ("com/foo/Bar" or "com.foo.Bar")
+            std::shared_ptr<const ReflectedClass> Find(std::string_view ClassName) const
+            {
+                std::string Name(ClassName);
+                std::replace(Name.begin(), Name.end(), '.', '/');
+
+                std::lock_guard<std::mutex> Lock(Mutex);
+                auto It = Classes.find(Name);
+                return It != Classes.end() ? It->second : nullptr;
+            }
+
+            // Forgets all classes in memory (the disk cache stays)
+            void Clear()
+            {
+                std::lock_guard<std::mutex> Lock(Mutex);
+                Classes.clear();
+            }
+
+            // Cache key of a class file (same hash as ClassReflector.HashClass)
+            static uint64_t HashClassFile(std::span<const uint8_t> ClassFile) noexcept
+            {
+                uint64_t Hash = ClassArchive::HashInit;
+                for (uint8_t Byte : ClassFile)
+                {
+                    Hash = ClassArchive::HashStep(Hash, Byte);
+                }
+                return Hash ? Hash : 1;
+            }
+
+        private:
+            // <Directory>/<hash>.jrfl (empty when there is no directory or hash)
+            std::filesystem::path CacheFile(::JNIEnv* Env, std::string_view Name, uint64_t Hash)
+            {
+                std::filesystem::path Folder;
+                {
+                    std::lock_guard<std::mutex> Lock(Mutex);
+                    Folder = Directory;
+                }
+                if (Folder.empty())
+                    return Folder;
+
+                if (!Hash && HashClass)
+                {
+                    jstring JAVA_Name = NewString(Env, Name);
+                    Hash = JAVA_Name ? (uint64_t)Env->CallStaticLongMethod(ReflectorClass, HashClass, JAVA_Name) : 0;
+                    if (JAVA_Name)
+                    {
+                        Env->DeleteLocalRef(JAVA_Name);
+                    }
+                }
+                if (!Hash)
+                    return std::filesystem::path();
+
+                char FileName[32];
+                std::snprintf(FileName, sizeof(FileName), "%016llx.jrfl", (unsigned long long)Hash);
+                return Folder / FileName;
+            }
+
+            static bool ReadFile(const std::filesystem::path& File, ReflectedClass& Target)
+            {
+                std::ifstream Stream(File, std::ios::binary);
+                std::vector<uint8_t> Bytes((std::istreambuf_iterator<char>(Stream)), std::istreambuf_iterator<char>());
+                return Stream.good() || Stream.eof() ? Target.Parse(Bytes) : false;
+            }
+            // Temporary file + rename (concurrent processes never see partial files)
+            static void WriteFile(const std::filesystem::path& File, std::span<const uint8_t> Bytes)
+            {
+                std::filesystem::path Temporary = File;
+                Temporary += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+                {
+                    std::ofstream Stream(Temporary, std::ios::binary | std::ios::trunc);
+                    Stream.write((const char*)Bytes.data(), (std::streamsize)Bytes.size());
+                    if (!Stream)
+                        return;
+                }
+
+                std::error_code Error;
+                std::filesystem::rename(Temporary, File, Error);
+                if (Error)
+                {
+                    std::filesystem::remove(Temporary, Error);
+                }
+            }
+
+        private:
+            mutable std::mutex Mutex;
+            std::unordered_map<std::string, std::shared_ptr<const ReflectedClass>> Classes;
+            std::filesystem::path Directory;
+            jclass ReflectorClass = nullptr;
+            jmethodID Export = nullptr;
+            jmethodID HashClass = nullptr;
+    };
+
+    // Lock free ring buffer of framed records in C++ memory, shared with java as direct ByteBuffer (com.fuechsl.jnihpp.Channel)
+    // Any number of producers (or one when MultiProducer is false) and a single consumer, on either side
+    // Layout (native byte order):
+    //   Header { u64 Capacity; u32 Flags; } | { u64 WriteIndex; } | { u64 ReadIndex; } | { u32 Waiting; } (one cache line each)
+    //   Data   Capacity bytes of records { i32 Length; i32 Type; u8 Payload[Length - 8]; } 8 byte aligned
+    // Length is published last (release), 0 means not committed yet, negative lengths skip the rest of the ring
+    class Channel
+    {
+        public:
+            // Layout constants (must match Channel.java)
+            static constexpr size_t CacheLine = 64;
+            static constexpr size_t HeaderSize = 4 * CacheLine;
+            static constexpr size_t RecordHeaderSize = 8;
+            static constexpr uint32_t FlagMultiProducer = 1;
+            // Largest capacity (java indexes the buffer with int)
+            static constexpr size_t MaxCapacity = (size_t)1 << 30;
+
+            // Construct (Capacity is rounded up to a power of two and limited to MaxCapacity)
+            Channel() = default;
+            Channel(size_t Capacity, bool MultiProducer = true)
+            {
+                size_t Size = 4 * RecordHeaderSize;
+                while (Size < std::min(Capacity, MaxCapacity))
+                {
+                    Size <<= 1;
+                }
+
+                Memory = (std::byte*)::operator new(HeaderSize + Size, std::align_val_t(CacheLine));
+                std::memset(Memory, 0, HeaderSize + Size);
+                *(uint64_t*)(Memory) = Size;
+                *(uint32_t*)(Memory + 8) = MultiProducer ? FlagMultiProducer : 0;
+                this->Capacity = Size;
+                this->MultiProducer = MultiProducer;
+            }
+            Channel(const Channel&) = delete;
+            Channel(Channel&& Other) noexcept :
+                Memory(std::exchange(Other.Memory, nullptr)),
+                Capacity(std::exchange(Other.Capacity, 0)),
+                MultiProducer(Other.MultiProducer)
+            {}
+            ~Channel()
+            {
+                if (Memory)
+                {
+                    ::operator delete(Memory, std::align_val_t(CacheLine));
+                }
+            }
+
+            // Move assign
+            Channel& operator=(const Channel&) = delete;
+            Channel& operator=(Channel&& Other) noexcept
+            {
+                if (this != &Other)
+                {
+                    this->~Channel();
+                    Memory = std::exchange(Other.Memory, nullptr);
+                    Capacity = std::exchange(Other.Capacity, 0);
+                    MultiProducer = Other.MultiProducer;
+                }
+                return *this;
+            }
+
+            // Direct buffer over the whole channel for java (new com.fuechsl.jnihpp.Channel(buffer), valid while this object lives)
+            jobject NewBuffer(::JNIEnv* Env) const noexcept
+            {
+                return Memory ? Env->NewDirectByteBuffer(Memory, (jlong)(HeaderSize + Capacity)) : nullptr;
+            }
+
+            // Largest payload a single record can carry
+            size_t MaxPayload() const noexcept
+            {
+                return Capacity / 2 - RecordHeaderSize;
+            }
+
+            // Appends a record (false when the channel is full or the payload too large)
+            bool Write(int32_t Type, const void* Payload, size_t Size) noexcept
+            {
+                if (!Memory || Size > MaxPayload())
+                {
+                    return false;
+                }
+
+                // Reserve (record must be contiguous, the rest of the ring is skipped otherwise)
+                uint64_t RecordSize = Align(RecordHeaderSize + Size);
+                std::atomic_ref<uint64_t> Write(WriteIndex());
+                uint64_t Position = Write.load(std::memory_order_relaxed);
+                uint64_t Padding;
+                do
+                {
+                    size_t Offset = (size_t)(Position & (Capacity - 1));
+                    Padding = Offset + RecordSize > Capacity ? Capacity - Offset : 0;
+                    if (Position + Padding + RecordSize - std::atomic_ref<uint64_t>(ReadIndex()).load(std::memory_order_acquire) > Capacity)
+                    {
+                        return false;
+                    }
+                    if (!MultiProducer)
+                    {
+                        Write.store(Position + Padding + RecordSize, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+                while (!Write.compare_exchange_weak(Position, Position + Padding + RecordSize, std::memory_order_relaxed));
+
+                // Skip marker
+                if (Padding)
+                {
+                    Length(Position).store(-(int32_t)Padding, std::memory_order_release);
+                }
+
+                // Payload first, length last
+                uint64_t Start = Position + Padding;
+                std::byte* Record = Data() + (Start & (Capacity - 1));
+                std::memcpy(Record + 4, &Type, 4);
+                if (Size)
+                {
+                    std::memcpy(Record + RecordHeaderSize, Payload, Size);
+                }
+                Length(Start).store((int32_t)(RecordHeaderSize + Size), std::memory_order_release);
+
+                // Wake the consumer only when it sleeps
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                Notify();
+                return true;
+            }
+            bool Write(int32_t Type, std::span<const std::byte> Payload) noexcept
+            {
+                return Write(Type, Payload.data(), Payload.size());
+            }
+
+            // Consumes up to Max records: OnRecord(int32_t Type, std::span<const std::byte> Payload), returns the record count
+            template<typename Handler>
+            size_t Read(Handler&& OnRecord, size_t Max = SIZE_MAX)
+            {
+                if (!Memory)
+                {
+                    return 0;
+                }
+
+                std::atomic_ref<uint64_t> ReadPosition(ReadIndex());
+                uint64_t Start = ReadPosition.load(std::memory_order_relaxed);
+                uint64_t Position = Start;
+                size_t Count = 0;
+
+                // At most one lap per call (the consumed memory is cleared on return)
+                while (Count < Max && Position - Start < Capacity)
+                {
+                    int32_t RecordLength = Length(Position).load(std::memory_order_acquire);
+                    if (RecordLength == 0)
+                    {
+                        break;
+                    }
+                    if (RecordLength < 0)
+                    {
+                        Position += (uint64_t)-RecordLength;
+                        continue;
+                    }
+
+                    const std::byte* Record = Data() + (Position & (Capacity - 1));
+                    int32_t Type;
+                    std::memcpy(&Type, Record + 4, 4);
+                    OnRecord(Type, std::span<const std::byte>(Record + RecordHeaderSize, (size_t)RecordLength - RecordHeaderSize));
+                    Position += Align((uint64_t)RecordLength);
+                    Count++;
+                }
+
+                // Clear consumed memory (uncommitted records must read as length 0) and hand it back
+                if (Position != Start)
+                {
+                    size_t Offset = (size_t)(Start & (Capacity - 1));
+                    size_t Bytes = (size_t)(Position - Start);
+                    size_t First = std::min(Bytes, Capacity - Offset);
+                    std::memset(Data() + Offset, 0, First);
+                    std::memset(Data(), 0, Bytes - First);
+                    ReadPosition.store(Position, std::memory_order_release);
+                }
+                return Count;
+            }
+
+            // Checks if a committed record is ready
+            bool IsEmpty() const noexcept
+            {
+                uint64_t Position = std::atomic_ref<uint64_t>(ReadIndex()).load(std::memory_order_acquire);
+                return Length(Position).load(std::memory_order_acquire) == 0;
+            }
+
+            // Blocks the consumer until a record is ready or Wake() is called (no wakeup cost while the consumer is busy)
+            void Wait() noexcept
+            {
+                if (!Memory)
+                {
+                    return;
+                }
+
+                std::atomic_ref<uint32_t> Flag(Waiting());
+                Flag.store(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (IsEmpty())
+                {
+                    Flag.wait(1, std::memory_order_acquire);
+                }
+                Flag.store(0, std::memory_order_relaxed);
+            }
+            // Wakes a waiting consumer (from C++ or java)
+            void Wake() noexcept
+            {
+                if (Memory)
+                {
+                    WakeWaiter(Memory);
+                }
+            }
+
+            // Callbacks for java (registered by JavaVM)
+            static void JAVA_NWait(JNIEnv* JAVA_Env, jclass JAVA_Class, jobject JAVA_Buffer)
+            {
+                std::byte* Base = (std::byte*)JAVA_Env->GetDirectBufferAddress(JAVA_Buffer);
+                if (Base)
+                {
+                    std::atomic_ref<uint32_t>(*(uint32_t*)(Base + 3 * CacheLine)).wait(1, std::memory_order_acquire);
+                }
+            }
+            static void JAVA_NWake(JNIEnv* JAVA_Env, jclass JAVA_Class, jobject JAVA_Buffer)
+            {
+                std::byte* Base = (std::byte*)JAVA_Env->GetDirectBufferAddress(JAVA_Buffer);
+                if (Base)
+                {
+                    WakeWaiter(Base);
+                }
+            }
+
+        private:
+            // Header fields (own cache line each, no false sharing between producers and consumer)
+            uint64_t& WriteIndex() const noexcept
+            {
+                return *(uint64_t*)(Memory + CacheLine);
+            }
+            uint64_t& ReadIndex() const noexcept
+            {
+                return *(uint64_t*)(Memory + 2 * CacheLine);
+            }
+            uint32_t& Waiting() const noexcept
+            {
+                return *(uint32_t*)(Memory + 3 * CacheLine);
+            }
+            std::byte* Data() const noexcept
+            {
+                return Memory + HeaderSize;
+            }
+            std::atomic_ref<int32_t> Length(uint64_t Position) const noexcept
+            {
+                return std::atomic_ref<int32_t>(*(int32_t*)(Data() + (Position & (Capacity - 1))));
+            }
+            static constexpr uint64_t Align(uint64_t Size) noexcept
+            {
+                return (Size + 7) & ~uint64_t(7);
+            }
+
+            // Wake when someone waits
+            void Notify() noexcept
+            {
+                if (std::atomic_ref<uint32_t>(Waiting()).load(std::memory_order_relaxed))
+                {
+                    WakeWaiter(Memory);
+                }
+            }
+            static void WakeWaiter(std::byte* Base) noexcept
+            {
+                std::atomic_ref<uint32_t> Flag(*(uint32_t*)(Base + 3 * CacheLine));
+                Flag.store(0, std::memory_order_release);
+                Flag.notify_all();
+            }
+
+        private:
+            std::byte* Memory = nullptr;
+            size_t Capacity = 0;
+            bool MultiProducer = true;
+    };
+
+    // Unit of work of the JavaExecutor
+    struct JavaJob
+    {
+        virtual ~JavaJob() = default;
+        virtual void Run(::JNIEnv* Env) noexcept = 0;
+    };
+    template<typename F>
+    struct JavaFunctionJob : JavaJob
+    {
+        JavaFunctionJob(F&& Function) :
+            Function(std::move(Function))
+        {}
+        void Run(::JNIEnv* Env) noexcept override
+        {
+            Function(Env);
+        }
+
+        F Function;
+    };
+
+    // Chase-Lev work stealing deque: the owner pushes and pops at the bottom, other threads steal from the top
+    // Grown rings are kept until destruction (a stealer may still read the old one)
+    template<typename T>
+    class WorkStealingDeque
+    {
+        public:
+            // Construct (Capacity is rounded up to a power of two)
+            WorkStealingDeque(size_t Capacity = 256)
+            {
+                size_t Size = 16;
+                while (Size < Capacity)
+                {
+                    Size <<= 1;
+                }
+                Rings.push_back(std::make_unique<Ring>(Size));
+                Items.store(Rings.back().get(), std::memory_order_relaxed);
+            }
+            WorkStealingDeque(const WorkStealingDeque&) = delete;
+            WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+            // Owner only
+            void Push(T* Item)
+            {
+                int64_t B = Bottom.load(std::memory_order_relaxed);
+                int64_t Tp = Top.load(std::memory_order_acquire);
+                Ring* Current = Items.load(std::memory_order_relaxed);
+                if (B - Tp > (int64_t)Current->Mask)
+                {
+                    // Grow
+                    Rings.push_back(std::make_unique<Ring>((Current->Mask + 1) * 2));
+                    Ring* Grown = Rings.back().get();
+                    for (int64_t i = Tp; i < B; i++)
+                    {
+                        Grown->Put(i, Current->Get(i));
+                    }
+                    Items.store(Grown, std::memory_order_release);
+                    Current = Grown;
+                }
+                Current->Put(B, Item);
+                std::atomic_thread_fence(std::memory_order_release);
+                Bottom.store(B + 1, std::memory_order_relaxed);
+            }
+            // Owner only (LIFO, nullptr when empty)
+            T* Pop() noexcept
+            {
+                int64_t B = Bottom.load(std::memory_order_relaxed) - 1;
+                Ring* Current = Items.load(std::memory_order_relaxed);
+                Bottom.store(B, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int64_t Tp = Top.load(std::memory_order_relaxed);
+
+                T* Item = nullptr;
+                if (Tp <= B)
+                {
+                    Item = Current->Get(B);
+                    if (Tp == B)
+                    {
+                        // Last item: race against stealers
+                        if (!Top.compare_exchange_strong(Tp, Tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                            Item = nullptr;
+                        Bottom.store(B + 1, std::memory_order_relaxed);
+                    }
+                }
+                else
+                {
+                    Bottom.store(B + 1, std::memory_order_relaxed);
+                }
+                return Item;
+            }
+            // Any thread (FIFO, nullptr when empty or when another thread won the race)
+            T* Steal() noexcept
+            {
+                int64_t Tp = Top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int64_t B = Bottom.load(std::memory_order_acquire);
+
+                T* Item = nullptr;
+                if (Tp < B)
+                {
+                    Item = Items.load(std::memory_order_acquire)->Get(Tp);
+                    if (!Top.compare_exchange_strong(Tp, Tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                        Item = nullptr;
+                }
+                return Item;
+            }
+
+            // Approximate emptiness
+            bool IsEmpty() const noexcept
+            {
+                return Bottom.load(std::memory_order_relaxed) <= Top.load(std::memory_order_relaxed);
+            }
+
+        private:
+            struct Ring
+            {
+                Ring(size_t Size) :
+                    Mask(Size - 1),
+                    Slots(std::make_unique<std::atomic<T*>[]>(Size))
+                {}
+                T* Get(int64_t Index) const noexcept
+                {
+                    return Slots[(size_t)Index & Mask].load(std::memory_order_relaxed);
+                }
+                void Put(int64_t Index, T* Item) noexcept
+                {
+                    Slots[(size_t)Index & Mask].store(Item, std::memory_order_relaxed);
+                }
+
+                size_t Mask;
+                std::unique_ptr<std::atomic<T*>[]> Slots;
+            };
+
+            alignas(64) std::atomic<int64_t> Top = 0;
+            alignas(64) std::atomic<int64_t> Bottom = 0;
+            std::atomic<Ring*> Items = nullptr;
+            std::vector<std::unique_ptr<Ring>> Rings;
+    };
+
+    // Bounded lock free multi producer / multi consumer queue (Vyukov), used for submissions from outside the pool
+    template<typename T>
+    class MPMCQueue
+    {
+        public:
+            // Construct (Capacity is rounded up to a power of two)
+            MPMCQueue(size_t Capacity)
+            {
+                size_t Size = 2;
+                while (Size < Capacity)
+                {
+                    Size <<= 1;
+                }
+                Mask = Size - 1;
+                Cells = std::make_unique<Cell[]>(Size);
+                for (size_t i = 0; i < Size; i++)
+                {
+                    Cells[i].Sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+            MPMCQueue(const MPMCQueue&) = delete;
+            MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+            // False when full
+            bool Push(T* Item) noexcept
+            {
+                size_t Position = Enqueue.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    Cell& Target = Cells[Position & Mask];
+                    size_t Sequence = Target.Sequence.load(std::memory_order_acquire);
+                    intptr_t Difference = (intptr_t)Sequence - (intptr_t)Position;
+                    if (Difference == 0)
+                    {
+                        if (Enqueue.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+                        {
+                            Target.Item = Item;
+                            Target.Sequence.store(Position + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (Difference < 0)
+                    {
+                        return false;
+                    }
+                    else
+                    {
+                        Position = Enqueue.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+            // nullptr when empty
+            T* Pop() noexcept
+            {
+                size_t Position = Dequeue.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    Cell& Source = Cells[Position & Mask];
+                    size_t Sequence = Source.Sequence.load(std::memory_order_acquire);
+                    intptr_t Difference = (intptr_t)Sequence - (intptr_t)(Position + 1);
+                    if (Difference == 0)
+                    {
+                        if (Dequeue.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+                        {
+                            T* Item = Source.Item;
+                            Source.Sequence.store(Position + Mask + 1, std::memory_order_release);
+                            return Item;
+                        }
+                    }
+                    else if (Difference < 0)
+                    {
+                        return nullptr;
+                    }
+                    else
+                    {
+                        Position = Dequeue.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+        private:
+            struct Cell
+            {
+                std::atomic<size_t> Sequence;
+                T* Item = nullptr;
+            };
+
+            std::unique_ptr<Cell[]> Cells;
+            size_t Mask = 0;
+            alignas(64) std::atomic<size_t> Enqueue = 0;
+            alignas(64) std::atomic<size_t> Dequeue = 0;
+    };
+
+    // Pool of permanently attached java worker threads (owned by JavaVM, see JavaVM::GetExecutor)
+    //   auto Length = Executor.Submit([](JNIEnv* Env) { ... return 42; });   // std::future<int>
+    //   int Value = co_await Executor.Run([](JNIEnv* Env) { return 42; });  // inside any coroutine
+    class JavaExecutor
+    {
+        public:
+            // Jobs a worker runs inside one local ref frame
+            static constexpr size_t FrameJobs = 64;
+
+            // Construct (Threads = 0 uses the hardware thread count, OnAttach runs once on every new worker)
+            JavaExecutor(::JavaVM* VM, jint Version, size_t Threads = 0, std::function<void(::JNIEnv*)> OnAttach = {}, size_t QueueCapacity = 65536) :
+                VM(VM),
+                Version(Version),
+                OnAttach(std::move(OnAttach)),
+                Injected(QueueCapacity)
+            {
+                Threads = Threads ? Threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+                for (size_t i = 0; i < Threads; i++)
+                {
+                    Workers.push_back(std::make_unique<Worker>());
+                }
+                for (size_t i = 0; i < Threads; i++)
+                {
+                    Workers[i]->Thread = std::thread(&JavaExecutor::WorkerMain, this, i);
+                }
+            }
+            JavaExecutor(const JavaExecutor&) = delete;
+            JavaExecutor& operator=(const JavaExecutor&) = delete;
+            ~JavaExecutor()
+            {
+                Shutdown();
+            }
+
+            // Runs Function(JNIEnv*) on a worker (the future holds a jni::JavaException for a java exception left pending, a std::runtime_error when the worker could not attach)
+            template<typename F, typename R = std::invoke_result_t<F, ::JNIEnv*>>
+            std::future<R> Submit(F&& Function)
+            {
+                std::future<R> Result;
+                Enqueue(MakeFutureJob(std::forward<F>(Function), Result), true);
+                return Result;
+            }
+            // Runs Function(JNIEnv*) on a worker without a result (exceptions are dropped, so is the job on a worker that could not attach)
+            template<typename F>
+            void Post(F&& Function)
+            {
+                Enqueue(MakeJob(std::forward<F>(Function)), true);
+            }
+
+            // Awaitable that runs Function(JNIEnv*) on a worker and resumes the coroutine there with the result
+            template<typename F>
+            class RunAwaitable
+            {
+                public:
+                    using ResultType = std::invoke_result_t<F, ::JNIEnv*>;
+
+                    RunAwaitable(JavaExecutor& Executor, F&& Function) :
+                        Executor(Executor),
+                        Function(std::move(Function))
+                    {}
+
+                    bool await_ready() const noexcept
+                    {
+                        return false;
+                    }
+                    void await_suspend(std::coroutine_handle<> Handle)
+                    {
+                        Executor.Enqueue(MakeJob<false>([this, Handle](::JNIEnv* Env)
+                        {
+                            try
+                            {
+                                ::JNIEnv* JobEnv = RequireEnv(Env);
+                                if constexpr (std::is_void_v<ResultType>)
+                                {
+                                    Function(JobEnv);
+                                    ThrowPendingException(JobEnv);
+                                    Result.emplace();
+                                }
+                                else
+                                {
+                                    Result.emplace(Function(JobEnv));
+                                    ThrowPendingException(JobEnv);
+                                }
+                            }
+                            catch (...)
+                            {
+                                Error = std::current_exception();
+                            }
+                            Handle.resume();
+                        }), true);
+                    }
+                    ResultType await_resume()
+                    {
+                        if (Error)
+                        {
+                            std::rethrow_exception(Error);
+                        }
+                        if constexpr (!std::is_void_v<ResultType>)
+                        {
+                            return std::move(*Result);
+                        }
+                    }
+
+                private:
+                    using Stored = std::conditional_t<std::is_void_v<ResultType>, char, ResultType>;
+
+                    JavaExecutor& Executor;
+                    F Function;
+                    std::optional<Stored> Result;
+                    std::exception_ptr Error;
+            };
+            template<typename F>
+            RunAwaitable<std::decay_t<F>> Run(F&& Function)
+            {
+                return RunAwaitable<std::decay_t<F>>(*this, std::decay_t<F>(std::forward<F>(Function)));
+            }
+
+            // Awaitable that continues the coroutine on a worker (JavaExecutor::CurrentEnv() is valid afterwards, throws when the worker could not attach)
+            struct ScheduleAwaitable
+            {
+                JavaExecutor& Executor;
+
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+                void await_suspend(std::coroutine_handle<> Handle)
+                {
+                    Executor.Enqueue(MakeJob<false>([Handle](::JNIEnv*) { Handle.resume(); }), true);
+                }
+                void await_resume() const
+                {
+                    RequireEnv(CurrentEnv());
+                }
+            };
+            ScheduleAwaitable Schedule() noexcept
+            {
+                return ScheduleAwaitable{ *this };
+            }
+
+            // Collects jobs and hands them to the pool with a single wakeup
+            class Batch
+            {
+                public:
+                    Batch(JavaExecutor& Executor) noexcept :
+                        Executor(Executor)
+                    {}
+                    Batch(const Batch&) = delete;
+                    Batch& operator=(const Batch&) = delete;
+                    ~Batch()
+                    {
+                        try
+                        {
+                            Commit();
+                        }
+                        catch (...)
+                        {
+                            // Jobs that could not be queued are dropped (their futures report broken_promise)
+                            for (JavaJob* Job : Jobs)
+                            {
+                                delete Job;
+                            }
+                            Jobs.clear();
+                        }
+                    }
+
+                    template<typename F, typename R = std::invoke_result_t<F, ::JNIEnv*>>
+                    std::future<R> Submit(F&& Function)
+                    {
+                        std::future<R> Result;
+                        Jobs.push_back(MakeFutureJob(std::forward<F>(Function), Result));
+                        return Result;
+                    }
+                    template<typename F>
+                    void Post(F&& Function)
+                    {
+                        Jobs.push_back(MakeJob(std::forward<F>(Function)));
+                    }
+
+                    // Enqueues all collected jobs (on a throw the jobs not queued yet stay in the batch)
+                    void Commit()
+                    {
+                        size_t Queued = 0;
+                        try
+                        {
+                            for (; Queued < Jobs.size(); Queued++)
+                            {
+                                Executor.Enqueue(Jobs[Queued], false);
+                            }
+                        }
+                        catch (...)
+                        {
+                            Jobs.erase(Jobs.begin(), Jobs.begin() + Queued);
+                            if (Queued)
+                            {
+                                Executor.Wake(Queued);
+                            }
+                            throw;
+                        }
+                        if (Queued)
+                        {
+                            Executor.Wake(Queued);
+                        }
+                        Jobs.clear();
+                    }
+
+                private:
+                    JavaExecutor& Executor;
+                    std::vector<JavaJob*> Jobs;
+            };
+
+            // Runs all queued jobs, then detaches and joins the workers (no submissions from outside afterwards)
+            // Called from a worker it only signals the stop, the workers are joined by the destructor (or a later call from outside)
+            void Shutdown()
+            {
+                if (!Stopping.exchange(true))
+                {
+                    Epoch.fetch_add(1, std::memory_order_seq_cst);
+                    Epoch.notify_all();
+                }
+                if (Current().Executor == this)
+                    return;
+
+                std::lock_guard<std::mutex> Lock(JoinMutex);
+                for (std::unique_ptr<Worker>& Current : Workers)
+                {
+                    if (Current->Thread.joinable())
+                        Current->Thread.join();
+                }
+            }
+
+            // Number of workers
+            size_t GetThreadCount() const noexcept
+            {
+                return Workers.size();
+            }
+
+            // JNIEnv of the calling worker (nullptr outside of a worker)
+            static ::JNIEnv* CurrentEnv() noexcept
+            {
+                return Current().Env;
+            }
+
+        private:
+            // Env of a worker whose attach failed: jobs fail instead of running without one
+            static ::JNIEnv* RequireEnv(::JNIEnv* Env)
+            {
+                if (!Env)
+                    throw std::runtime_error("jni::JavaExecutor: worker thread is not attached to the vm");
+                return Env;
+            }
+
+            // Job factories (NeedsEnv = false for internal jobs that handle a missing env themselves)
+            template<bool NeedsEnv = true, typename F>
+            static JavaJob* MakeJob(F&& Function)
+            {
+                auto Safe = [Function = std::decay_t<F>(std::forward<F>(Function))](::JNIEnv* Env) mutable
+                {
+                    try
+                    {
+                        if constexpr (NeedsEnv)
+                            Function(RequireEnv(Env));
+                        else
+                            Function(Env);
+                    }
+                    catch (...)
+                    {
+                    }
+                };
+                return new JavaFunctionJob<decltype(Safe)>(std::move(Safe));
+            }
+            template<typename F, typename R>
+            static JavaJob* MakeFutureJob(F&& Function, std::future<R>& Result)
+            {
+                std::promise<R> Promise;
+                Result = Promise.get_future();
+                auto Body = [Function = std::decay_t<F>(std::forward<F>(Function)), Promise = std::move(Promise)](::JNIEnv* Env) mutable
+                {
+                    // A java exception left pending by the job fails the future (jni::JavaException)
+                    try
+                    {
+                        ::JNIEnv* JobEnv = RequireEnv(Env);
+                        if constexpr (std::is_void_v<R>)
+                        {
+                            Function(JobEnv);
+                            ThrowPendingException(JobEnv);
+                            Promise.set_value();
+                        }
+                        else
+                        {
+                            R Value = Function(JobEnv);
+                            ThrowPendingException(JobEnv);
+                            Promise.set_value(std::move(Value));
+                        }
+                    }
+                    catch (...)
+                    {
+                        Promise.set_exception(std::current_exception());
+                    }
+                };
+                return new JavaFunctionJob<decltype(Body)>(std::move(Body));
+            }
+
+            // Worker state
+            struct Worker
+            {
+                std::thread Thread;
+                WorkStealingDeque<JavaJob> Jobs;
+            };
+            struct WorkerContext
+            {
+                JavaExecutor* Executor = nullptr;
+                size_t Index = 0;
+                ::JNIEnv* Env = nullptr;
+            };
+            static WorkerContext& Current() noexcept
+            {
+                static thread_local WorkerContext Context;
+                return Context;
+            }
+
+            // Local deque on own workers, shared queue otherwise (waits while full)
+            void Enqueue(JavaJob* Job, bool WakeOne)
+            {
+                if (Current().Executor == this)
+                {
+                    Workers[Current().Index]->Jobs.Push(Job);
+                }
+                else
+                {
+                    while (!Injected.Push(Job))
+                    {
+                        Wake(Workers.size());
+                        std::this_thread::yield();
+                    }
+                }
+                if (WakeOne)
+                {
+                    Wake(1);
+                }
+            }
+            // Wakes sleeping workers (no syscall when nobody sleeps)
+            void Wake(size_t Count) noexcept
+            {
+                Epoch.fetch_add(1, std::memory_order_seq_cst);
+                if (Sleeping.load(std::memory_order_seq_cst))
+                {
+                    if (Count == 1)
+                        Epoch.notify_one();
+                    else
+                        Epoch.notify_all();
+                }
+            }
+
+            // Own deque, then shared queue, then steal
+            JavaJob* FindWork(size_t Index) noexcept
+            {
+                JavaJob* Job = Workers[Index]->Jobs.Pop();
+                if (!Job)
+                {
+                    Job = Injected.Pop();
+                }
+                for (size_t i = 1; !Job && i < Workers.size(); i++)
+                {
+                    Job = Workers[(Index + i) % Workers.size()]->Jobs.Steal();
+                }
+                return Job;
+            }
+
+            void WorkerMain(size_t Index)
+            {
+                // Attach once for the lifetime of the pool (without an env the worker fails its jobs, see RequireEnv)
+                ::JNIEnv* Env = nullptr;
+                JavaVMAttachArgs Args;
+                Args.version = Version;
+                Args.name = (char*)"jnihpp-executor";
+                Args.group = nullptr;
+                if (VM->AttachCurrentThreadAsDaemon((void**)&Env, &Args) != JNI_OK)
+                {
+                    Env = nullptr;
+                }
+                if (Env && OnAttach)
+                {
+                    OnAttach(Env);
+                }
+                Current() = WorkerContext{ this, Index, Env };
+
+                while (true)
+                {
+                    JavaJob* Job = FindWork(Index);
+                    if (Job)
+                    {
+                        // Warm frame: local refs of up to FrameJobs jobs are released with one pop
+                        bool Frame = Env && Env->PushLocalFrame(16) == JNI_OK;
+                        for (size_t Count = 0; Job; Job = ++Count < FrameJobs ? FindWork(Index) : nullptr)
+                        {
+                            Job->Run(Env);
+                            delete Job;
+                            if (Env && Env->ExceptionCheck())
+                            {
+                                Env->ExceptionClear();
+                            }
+                        }
+                        if (Frame)
+                        {
+                            Env->PopLocalFrame(nullptr);
+                        }
+                        continue;
+                    }
+
+                    // Idle: announce, recheck, sleep until the epoch changes
+                    uint32_t Seen = Epoch.load(std::memory_order_acquire);
+                    Sleeping.fetch_add(1, std::memory_order_seq_cst);
+                    Job = FindWork(Index);
+                    bool Stop = Stopping.load(std::memory_order_acquire);
+                    if (!Job && !Stop)
+                    {
+                        Epoch.wait(Seen, std::memory_order_acquire);
+                    }
+                    Sleeping.fetch_sub(1, std::memory_order_relaxed);
+
+                    if (Job)
+                    {
+                        // Picked up by the next iteration
+                        Workers[Index]->Jobs.Push(Job);
+                    }
+                    else if (Stop)
+                    {
+                        break;
+                    }
+                }
+
+                Current() = WorkerContext();
+                if (Env)
+                {
+                    VM->DetachCurrentThread();
+                }
+            }
+
+        private:
+            ::JavaVM* VM;
+            jint Version;
+            std::function<void(::JNIEnv*)> OnAttach;
+
+            std::vector<std::unique_ptr<Worker>> Workers;
+            MPMCQueue<JavaJob> Injected;
+
+            std::atomic<uint32_t> Epoch = 0;
+            std::atomic<uint32_t> Sleeping = 0;
+            std::atomic<bool> Stopping = false;
+            std::mutex JoinMutex;
+    };
+
+    // Usage of the startup profile (see JavaVM::SetStartupProfile)
+    enum class StartupProfileMode
+    {
+        // Record all loaded classes (written on StopVM)
+        Train,
+        // Preload the recorded classes on helper threads right after StartVM
+        Replay,
+    };
+
+    // Relevant java class, function, field, ... table
+    struct JAVA_Table
+    {
+        jclass JAVA_Cls_ClassLoader = nullptr;
+        jfieldID JAVA_Fld_ClassLoader_InstanceId = nullptr;
+        jmethodID JAVA_Mth_ClassLoader_DefineNativeClass = nullptr;
+        jmethodID JAVA_Mth_ClassLoader_SetKnownClasses = nullptr;
+        jmethodID JAVA_Mth_ClassLoader_InvalidateClassCache = nullptr;
+        jmethodID JAVA_Mth_ClassLoader_LoadClass = nullptr;
+        jmethodID JAVA_Mth_ClassLoader_LoadClasses = nullptr;
+        jmethodID JAVA_Mth_ClassLoader_Preload = nullptr;
+
+        jclass JAVA_Cls_String = nullptr;
+
+        jclass JAVA_Cls_Setup = nullptr;
+        jmethodID JAVA_Mth_Setup_RunSetup = nullptr;
+        jmethodID JAVA_Mth_Setup_Flush = nullptr;
+
+        jclass JAVA_Cls_NativeOutputStream = nullptr;
+
+        jclass JAVA_Cls_NativeInputStream = nullptr;
+
+        jclass JAVA_Cls_Channel = nullptr;
+
+        jclass JAVA_Cls_ClassReflector = nullptr;
+        jmethodID JAVA_Mth_ClassReflector_Export = nullptr;
+        jmethodID JAVA_Mth_ClassReflector_HashClass = nullptr;
+
+        jclass JAVA_Cls_Thread = nullptr;
+        jmethodID JAVA_Mth_Thread_CurrentThread = nullptr;
+        jmethodID JAVA_Mth_Thread_SetContextClassLoader = nullptr;
+
+        jobject JAVA_Obj_SystemClassLoader = nullptr;
+    };
+
+    // Class that interfaces with JNI (override this class)
+    class JavaVM
+    {
+        public:
+            // Construct
+            JavaVM() noexcept = default;
+            JavaVM(const JavaVM&) noexcept = delete;
+            JavaVM(JavaVM&& Other) noexcept
+            {
+                // Do a assign operation
+                *this = std::move(Other);
+            }
+
+            // Assign
+            JavaVM& operator=(const JavaVM&) noexcept = delete;
+            JavaVM& operator=(JavaVM&& Other) noexcept
+            {
+                // Prevent self move
+                if (&Other != this)
+                {
+                    // Move and unset critical
+                    JVM = Other.JVM;
+                    Other.JVM = nullptr;
+                    JNIVersion = Other.JNIVersion;
+                    AttachAsDaemon = Other.AttachAsDaemon;
+
+                    // Copy jvt
+                    jvt = Other.jvt;
+
+                    // Take archives
+                    Archives = std::move(Other.Archives);
+                    Classes = std::move(Other.Classes);
+                    Profile = std::move(Other.Profile);
+                    Executor = std::move(Other.Executor);
+                    Reflection = std::move(Other.Reflection);
+                }
+
+                return *this;
+            }
+
+            // Virtual destruct
+            virtual ~JavaVM()
+            {
+                StopVM();
+            }
+
+            // JNIEnv of the calling thread
+            ::JNIEnv* operator->() noexcept
+            {
+                return GetEnv();
+            }
+
+            // JNIEnv of the calling thread (attached lazily and detached at thread exit, nullptr when the vm is not running)
+            ::JNIEnv* GetEnv() noexcept
+            {
+                ThreadState& State = GetThreadState();
+                if (State.Env && State.Generation == VMGeneration.load(std::memory_order_acquire))
+                {
+                    return State.Env;
+                }
+
+                return AttachCurrentThread(AttachAsDaemon);
+            }
+
+            // Attaches the calling thread (no-op when already attached, returns the thread's JNIEnv)
+            ::JNIEnv* AttachCurrentThread(bool AsDaemon, const char* ThreadName = nullptr) noexcept
+            {
+                // Cached
+                ThreadState& State = GetThreadState();
+                uint64_t Generation = VMGeneration.load(std::memory_order_acquire);
+                if (State.Env && State.Generation == Generation)
+                {
+                    return State.Env;
+                }
+
+                // Vm is being destroyed (keep the attachment, the thread must still be able to detach)
+                if (State.Env && State.Generation == DestroyingGeneration.load(std::memory_order_acquire))
+                {
+                    return nullptr;
+                }
+                State.Forget();
+                if (!JVM)
+                {
+                    return nullptr;
+                }
+
+                // Already attached by someone else?
+                ::JNIEnv* Env = nullptr;
+                jint Result = JVM->GetEnv((void**)&Env, JNIVersion);
+                bool Attached = false;
+                if (Result == JNI_EDETACHED)
+                {
+                    // Attach
+                    JavaVMAttachArgs Args;
+                    Args.version = JNIVersion;
+                    Args.name = (char*)ThreadName;
+                    Args.group = nullptr;
+                    Result = AsDaemon ? JVM->AttachCurrentThreadAsDaemon((void**)&Env, &Args) : JVM->AttachCurrentThread((void**)&Env, &Args);
+                    Attached = Result == JNI_OK;
+
+                    // Let FindClass and friends see natively loaded classes
+                    if (Attached)
+                    {
+                        SetContextClassLoader(Env, jvt);
+                    }
+                }
+
+                // Cache
+                if (Result == JNI_OK)
+                {
+                    State.VM = JVM;
+                    State.Env = Env;
+                    State.Attached = Attached;
+                    State.Generation = Generation;
+                }
+
+                return Result == JNI_OK ? Env : nullptr;
+            }
+
+            // Detaches the calling thread (only when it was attached by this class)
+            void DetachCurrentThread() noexcept
+            {
+                GetThreadState().Detach();
+            }
+
+            // Class through the shared cache ("com/foo/Bar" or "com.foo.Bar", the global ref is owned by the cache)
+            // Resolved once through the jni-hpp class loader, independent of the calling thread
+            jclass FindClass(std::string_view Name)
+            {
+                ::JNIEnv* Env = GetEnv();
+                return Env && Classes ? Classes->Get(Env, Name) : nullptr;
+            }
+            // Resolves and caches classes with a single java call (returns the number of classes found)
+            size_t PreloadClasses(const std::vector<std::string>& Names)
+            {
+                ::JNIEnv* Env = GetEnv();
+                return Env && Classes ? Classes->Preload(Env, Names) : 0;
+            }
+            // Shared class cache (nullptr while the vm is not running)
+            ClassCache* GetClassCache() noexcept
+            {
+                return Classes.get();
+            }
+
+            // Persists reflected classes in Directory (keyed by class file hash, valid across runs)
+            void SetReflectionCache(const std::filesystem::path& Directory)
+            {
+                if (Reflection)
+                {
+                    Reflection->SetDirectory(Directory);
+                }
+            }
+            // Metadata of a class (one export call per class, a disk cache hit only needs the class file hash)
+            std::shared_ptr<const ReflectedClass> ReflectClass(std::string_view Name)
+            {
+                std::shared_ptr<const ReflectedClass> Class = Reflection ? Reflection->Find(Name) : nullptr;
+                ::JNIEnv* Env = Class || !Reflection ? nullptr : GetEnv();
+                if (Env)
+                {
+                    // Classes served from C++ are hashed here, all others by java
+                    std::string BinaryName(Name);
+                    std::replace(BinaryName.begin(), BinaryName.end(), '/', '.');
+                    MemoryBlock Content = LoadClassData(BinaryName);
+                    uint64_t Hash = Content ? ReflectionCache::HashClassFile({ (const uint8_t*)Content.GetData(), Content.GetSize() }) : 0;
+                    Class = Reflection->Get(Env, Name, Hash);
+                }
+                return Class;
+            }
+
+            // Enables the startup profile stored in Directory (only before StartVM, Threads = 0 uses half of the hardware threads)
+            // Train: records every loaded class and creates the CDS archive, Replay: preloads the recorded classes in parallel
+            bool SetStartupProfile(const std::filesystem::path& Directory, StartupProfileMode Mode, size_t Threads = 0)
+            {
+                if (JVM)
+                {
+                    return false;
+                }
+
+                std::error_code Error;
+                std::filesystem::create_directories(Directory, Error);
+                Profile = std::make_unique<StartupProfile>();
+                Profile->Directory = Directory;
+                Profile->Mode = Mode;
+                Profile->Threads = Threads;
+                return !Error;
+            }
+            // Blocks until the profile replay is done
+            void WaitForStartupProfile()
+            {
+                if (Profile)
+                {
+                    for (std::thread& Worker : Profile->Workers)
+                    {
+                        Worker.join();
+                    }
+                    Profile->Workers.clear();
+                }
+            }
+            // Recorded class names (class load log order, natively served classes last)
+            static std::vector<std::string> ReadStartupProfile(const std::filesystem::path& Directory)
+            {
+                std::vector<std::string> Names;
+                std::unordered_set<std::string> Seen;
+                for (const char* File : { "classes.log", "native.lst" })
+                {
+                    std::ifstream Stream(Directory / File);
+                    std::string Line;
+                    while (std::getline(Stream, Line))
+                    {
+                        // "com.foo.Bar source: ..." (hidden classes contain a '/' and can't be loaded by name)
+                        std::string Name = Line.substr(0, Line.find_first_of(" \r"));
+                        if (!Name.empty() && Name.find('/') == std::string::npos && Seen.insert(Name).second)
+                        {
+                            Names.push_back(std::move(Name));
+                        }
+                    }
+                }
+                return Names;
+            }
+
+            // Pool of permanently attached worker threads for java calls (created on first use with Threads workers, 0 = hardware threads)
+            JavaExecutor* GetExecutor(size_t Threads = 0)
+            {
+                std::lock_guard<std::mutex> Lock(ExecutorMutex);
+                if (!Executor && JVM)
+                {
+                    // Workers see natively loaded classes too
+                    Executor = std::make_unique<JavaExecutor>(JVM, JNIVersion, Threads, [Table = jvt](::JNIEnv* Env) { SetContextClassLoader(Env, Table); });
+                }
+                return Executor.get();
+            }
+
+            // Deletes the global refs of dropped jni::Global / jni::Weak handles
+            void ReleaseGlobalRefs()
+            {
+                ::JNIEnv* Env = GetEnv();
+                if (Env)
+                {
+                    GlobalRefPool::Instance().Release(Env);
+                }
+            }
+
+            // Checks if the calling thread is attached to the vm
+            bool IsCurrentThreadAttached() noexcept
+            {
+                ::JNIEnv* Env = nullptr;
+                return JVM && JVM->GetEnv((void**)&Env, JNIVersion) == JNI_OK;
+            }
+
+            // Threads attached by GetEnv() / operator-> are daemons (default) or normal threads (DestroyJavaVM waits for them)
+            void SetAttachAsDaemon(bool AsDaemon) noexcept
+            {
+                AttachAsDaemon = AsDaemon;
+            }
+
+        public:
+            // Starts the Java VM (Returns true on success)
+            bool StartVM()
+            {
+                bool JvmOk = false;
+                
+                if (!JVM)
+                {
+                    // Create a new JVM Argument object and run custom setup
+                    VMArguments VmArgs;
+                    SetupVM_Internal(VmArgs);
+                    SetupVM(VmArgs);
+
+                    // Create a java vm
+                    ::JNIEnv* Env = nullptr;
+                    const JavaVMInitArgs& InitArgs = VmArgs.Get();
+                    if (JNI_CreateJavaVM(&JVM, (void**)&Env, (void*)&InitArgs) == JNI_OK)
+                    {
+                        // Creating thread is attached by the vm itself
+                        JNIVersion = InitArgs.version;
+                        ThreadState& State = GetThreadState();
+                        State.Forget();
+                        State.VM = JVM;
+                        State.Env = Env;
+                        State.Generation = VMGeneration.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+                        // Load refs and setup natives
+                        if (LoadAllJavaRefs() && RegisterNatives() && SetupClassStates())
+                        {
+                            // Class cache resolving through the jni-hpp loader
+                            Classes = std::make_unique<ClassCache>();
+                            Classes->Bind(jvt.JAVA_Cls_ClassLoader, jvt.JAVA_Cls_String, jvt.JAVA_Mth_ClassLoader_LoadClass, jvt.JAVA_Mth_ClassLoader_LoadClasses);
+                            Reflection->Bind(jvt.JAVA_Cls_ClassReflector, jvt.JAVA_Mth_ClassReflector_Export, jvt.JAVA_Mth_ClassReflector_HashClass);
+
+                            // Warm up in the background
+                            if (Profile && Profile->Mode == StartupProfileMode::Replay)
+                            {
+                                StartProfileReplay();
+                            }
+                            JvmOk = true;
+                        }
+                        else
+                        {
+                            // Direct stop
+                            StopVM();
+                        }
+                    }
+                }
+
+                return JvmOk;
+            }
+
+            // Stops the Java VM
+            void StopVM()
+            {
+                // Destroy and unset if possible
+                if (JVM)
+                {
+                    // Workers and replay threads have to be done before the vm goes away
+                    if (Executor)
+                    {
+                        Executor->Shutdown();
+                        Executor.reset();
+                    }
+                    if (Profile)
+                    {
+                        Profile->Stop = true;
+                    }
+                    WaitForStartupProfile();
+
+                    // Hand remaining buffered output to C++
+                    ::JNIEnv* Env = GetEnv();
+                    if (Env && jvt.JAVA_Mth_Setup_Flush)
+                    {
+                        Env->CallStaticVoidMethod(jvt.JAVA_Cls_Setup, jvt.JAVA_Mth_Setup_Flush);
+                    }
+
+                    // Delete cached classes and dropped handles (refs still held by live handles die with the vm)
+                    if (Classes)
+                    {
+                        Classes->Clear(Env);
+                        Classes.reset();
+                    }
+                    if (Reflection)
+                    {
+                        Reflection->Bind(nullptr, nullptr, nullptr);
+                        Reflection->Clear();
+                    }
+                    if (Env)
+                    {
+                        GlobalRefPool::Instance().Release(Env);
+                    }
+                    GlobalRefPool::Instance().Discard();
+
+                    // Invalidate all cached thread envs (threads of this vm may still detach until it is destroyed)
+                    DestroyingGeneration.store(VMGeneration.fetch_add(1, std::memory_order_acq_rel), std::memory_order_release);
+                    GetThreadState().Forget();
+
+                    // Waits for all non daemon threads to detach
+                    JVM->DestroyJavaVM();
+                    DestroyingGeneration.store(0, std::memory_order_release);
+                    JVM = nullptr;
+                    jvt = JAVA_Table();
+
+                    // Persist the natively served classes (the vm wrote its class load log itself)
+                    if (Profile && Profile->Mode == StartupProfileMode::Train)
+                    {
+                        std::lock_guard<std::mutex> Lock(Profile->Mutex);
+                        std::ofstream Stream(Profile->Directory / "native.lst", std::ios::trunc);
+                        for (const std::string& Name : Profile->Served)
+                        {
+                            Stream << Name << '\n';
+                        }
+                        Profile->Served.clear();
+                    }
+                }
             }
 
-            ::JNIEnv* operator->() noexcept
+            // Get the current JVM state
+            bool IsRunning()
             {
-                return JNIEnv;
+                return JVM != nullptr;
             }
 
-        public:
-            // Starts the Java VM (Returns true on success)
-            bool StartVM()
+            // Adds a packed class / resource archive served by the default LoadClassData / LoadResourceData (call before StartVM)
+            // The archive stays mapped as long as this object lives
+            bool AddClassArchive(const std::filesystem::path& Path)
             {
-                bool JvmOk = false;
-                
-                if (!JVM)
+                ClassArchive Archive;
+                bool Ok = !JVM && Archive.Open(Path);
+                if (Ok)
                 {
-                    // Create a new JVM Argument object and run custom setup
-                    VMArguments VmArgs;
-                    SetupVM_Internal(VmArgs);
-                    SetupVM(VmArgs);
+                    Archives.push_back(std::move(Archive));
+                }
 
-                    // Create a java vm
-                    if (JNI_CreateJavaVM(&JVM, (void**)&JNIEnv, (void*)&VmArgs.Get()) == JNI_OK)
+                return Ok;
+            }
+
+            // Pushes the complete list of classes C++ can deliver to java (all other names are rejected without calling C++)
+            // Binary names ("com.foo.Bar"), classes of the archives are added when IncludeArchives is set
+            bool PublishKnownClasses(const std::vector<std::string>& ClassNames, bool IncludeArchives = true)
+            {
+                // Collect names
+                std::vector<std::string> Names = ClassNames;
+                if (IncludeArchives)
+                {
+                    constexpr std::string_view ClassSuffix = ".class";
+                    for (const ClassArchive& Archive : Archives)
                     {
-                        // Load refs and setup natives
-                        if (LoadAllJavaRefs() && RegisterNatives() && SetupClassStates())
-                        {
-                            JvmOk = true;
-                        }
-                        else
+                        for (size_t i = 0; i < Archive.GetEntryCount(); i++)
                         {
-                            // Direct stop
-                            StopVM();
+                            std::string_view EntryName = Archive.GetEntryName(i);
+                            if (EntryName.size() > ClassSuffix.size() && EntryName.substr(EntryName.size() - ClassSuffix.size()) == ClassSuffix)
+                            {
+                                std::string Name(EntryName.substr(0, EntryName.size() - ClassSuffix.size()));
+                                std::replace(Name.begin(), Name.end(), '/', '.');
+                                Names.push_back(std::move(Name));
+                            }
                         }
                     }
                 }
 
-                return JvmOk;
+                // Build java array
+                bool Ok = false;
+                ::JNIEnv* Env = GetEnv();
+                if (Env)
+                {
+                    jobjectArray JAVA_Names = Env->NewObjectArray((jsize)Names.size(), jvt.JAVA_Cls_String, nullptr);
+                    for (jsize i = 0; JAVA_Names && i < (jsize)Names.size(); i++)
+                    {
+                        jstring JAVA_Name = NewString(Env, Names[i]);
+                        Env->SetObjectArrayElement(JAVA_Names, i, JAVA_Name);
+                        Env->DeleteLocalRef(JAVA_Name);
+                    }
+
+                    // Call
+                    if (JAVA_Names)
+                    {
+                        Env->CallStaticVoidMethod(jvt.JAVA_Cls_ClassLoader, jvt.JAVA_Mth_ClassLoader_SetKnownClasses, JAVA_Names);
+                        Env->DeleteLocalRef(JAVA_Names);
+                    }
+                    Ok = JAVA_Names && !Env->ExceptionCheck();
+                    Env->ExceptionClear();
+                }
+
+                return Ok;
             }
 
-            // Stops the Java VM
-            void StopVM()
+            // Forget the known class list (every miss asks C++ again)
+            bool ClearKnownClasses()
             {
-                // Destroy and unset if possible
-                if (JVM)
+                bool Ok = false;
+                ::JNIEnv* Env = GetEnv();
+                if (Env)
                 {
-                    JVM->DestroyJavaVM();
-                    JVM = nullptr;
-                    JNIEnv = nullptr;
+                    Env->CallStaticVoidMethod(jvt.JAVA_Cls_ClassLoader, jvt.JAVA_Mth_ClassLoader_SetKnownClasses, nullptr);
+                    Ok = !Env->ExceptionCheck();
+                    Env->ExceptionClear();
                 }
+
+                return Ok;
             }
 
-            // Get the current JVM state
-            bool IsRunning()
+            // Forget cached misses of the native class loader (all when ClassName is empty)
+            bool InvalidateClassCache(const std::string& ClassName = std::string())
             {
-                return JVM != nullptr;
+                bool Ok = false;
+                ::JNIEnv* Env = GetEnv();
+                if (Env)
+                {
+                    jstring JAVA_Name = ClassName.empty() ? nullptr : NewString(Env, ClassName);
+                    Env->CallStaticVoidMethod(jvt.JAVA_Cls_ClassLoader, jvt.JAVA_Mth_ClassLoader_InvalidateClassCache, JAVA_Name);
+                    if (JAVA_Name)
+                        Env->DeleteLocalRef(JAVA_Name);
+                    Ok = !Env->ExceptionCheck();
+                    Env->ExceptionClear();
+                }
+
+                return Ok;
             }
 
         protected:
             // Virtual function called on vm start
             virtual void SetupVM(jni::VMArguments& Args) = 0;
             // Virtual function that is called when the class cannot be loaded by java
-            // If ClassName is loaded by c++ code: Allocate memory for pointer "*ClassContent" and return size of allocated buffer (aka class content length)
+            // Return the class bytes (java defines the class directly from this memory, the block is released afterwards)
+            // Default searches the archives and forwards to LoadClass(...) afterwards
+            virtual MemoryBlock LoadClassData(std::string_view ClassName)
+            {
+                for (const ClassArchive& Archive : Archives)
+                {
+                    std::string_view ClassBytes = Archive.FindClass(ClassName);
+                    if (!ClassBytes.empty())
+                        return MemoryBlock::Static(ClassBytes.data(), ClassBytes.size());
+                }
+
+                char* ClassContent = nullptr;
+                jsize ClassContentSize = LoadClass(std::string(ClassName), &ClassContent);
+                if (ClassContent && ClassContentSize <= 0)
+                {
+                    delete[] ClassContent;
+                    ClassContent = nullptr;
+                }
+
+                return ClassContent ? MemoryBlock::FromNewArray(ClassContent, (size_t)ClassContentSize) : MemoryBlock();
+            }
+            // Virtual function that is called when a resource cannot be found by java ("com/foo/bar.txt")
+            // Static blocks must stay valid while the VM is running (they are streamed without copying), others are copied and released
+            virtual MemoryBlock LoadResourceData(std::string_view ResourceName)
+            {
+                for (const ClassArchive& Archive : Archives)
+                {
+                    std::string_view ResourceBytes = Archive.FindResource(ResourceName);
+                    if (ResourceBytes.data())
+                        return MemoryBlock::Static(ResourceBytes.data(), ResourceBytes.size());
+                }
+
+                return MemoryBlock();
+            }
+            // Virtual function that is called when java only needs to know if a resource exists (ClassLoader.findResource)
+            // Default searches the archives and loads the resource through LoadResourceData(...) afterwards (override when that is expensive)
+            virtual bool HasResource(std::string_view ResourceName)
+            {
+                for (const ClassArchive& Archive : Archives)
+                {
+                    if (Archive.FindResource(ResourceName).data())
+                        return true;
+                }
+
+                return (bool)LoadResourceData(ResourceName).GetData();
+            }
+            // Virtual function that is called when the class cannot be loaded by java (copying version of LoadClassData)
+            // If ClassName is loaded by c++ code: Allocate memory with new char[...] for pointer "*ClassContent" and return size of allocated buffer (aka class content length)
             virtual jsize LoadClass(const std::string& ClassName, char** ClassContent)
             { 
                 return 0; 
             };
-            // All java System.out will be redirected to this callback
-            virtual void SystemOut(const char* Message)
+            // All java System.out will be redirected to this callback (batches of UTF-8 bytes, not NUL-terminated)
+            virtual void SystemOut(const char* Message, size_t Length)
             {
-                std::cout << Message;
+                std::cout.write(Message, (std::streamsize)Length);
             }
-            // All java System.err will be redirected to this callback
-            virtual void SystemErr(const char* Message)
+            // All java System.err will be redirected to this callback (batches of UTF-8 bytes, not NUL-terminated)
+            virtual void SystemErr(const char* Message, size_t Length)
             {
-                std::cerr << Message;
+                std::cerr.write(Message, (std::streamsize)Length);
             }
             // Read single char (blocking)
             virtual bool SystemIn(char* c)
             {
-                // Check if can read and then set
-                int CharValue = getchar();
-                bool IsEOF = CharValue == EOF;
-                if (!IsEOF)
+                Stdin.InUse.store(true, std::memory_order_relaxed);
+                return Stdin.Get(c);
+            }
+            // Checks if reading is possible
+            virtual bool SystemInCanRead()
+            {
+                return Stdin.Poll();
+            }
+            // Read up to Max chars into Destination (blocks until one char is available, returns 0 on EOF)
+            // Default copies the stdin buffer in bulk, overridden SystemIn(...) / SystemInCanRead() are called per char
+            virtual size_t SystemInRead(char* Destination, size_t Max)
+            {
+                size_t Count = 0;
+                if (Max && SystemIn(Destination))
                 {
-                    *c = CharValue;
+                    Count = 1;
+                    if (Stdin.InUse.load(std::memory_order_relaxed))
+                    {
+                        // Buffered bytes plus one non blocking read
+                        Count += Stdin.Take(Destination + Count, Max - Count);
+                    }
+                    else
+                    {
+                        // Take everything that will not block
+                        while (Count < Max && SystemInCanRead() && SystemIn(Destination + Count))
+                        {
+                            Count++;
+                        }
+                    }
                 }
 
-                return !IsEOF;
+                return Count;
             }
-            // Checks if reading is possible
-            virtual bool SystemInCanRead()
+            // Number of chars that can be read without blocking
+            // Default: buffered bytes plus the bytes pending on stdin (FIONREAD / PeekNamedPipe), SystemInCanRead() as last fallback
+            virtual size_t SystemInAvailable()
             {
-                return std::cin.rdbuf()->in_avail() > 0;
+                size_t Count = Stdin.Available();
+                return Count ? Count : (SystemInCanRead() ? std::max<size_t>(Stdin.Available(), 1) : 0);
             }
 
         private:
@@ -324,71 +5804,205 @@ namespace jni
             {
                 // Magically fit in our class loader
                 Args.AddOption("-Djava.system.class.loader=com.fuechsl.jnihpp.ClassLoader");
+
+                // Class load log and CDS archive
+                if (Profile)
+                {
+                    Args.AddStartupProfile(Profile->Directory, Profile->Mode == StartupProfileMode::Train);
+                }
+            }
+
+            // Starts the daemon threads that load the recorded classes
+            void StartProfileReplay()
+            {
+                std::shared_ptr<const std::vector<std::string>> Names = std::make_shared<const std::vector<std::string>>(ReadStartupProfile(Profile->Directory));
+                if (Names->empty())
+                {
+                    return;
+                }
+
+                size_t Threads = Profile->Threads ? Profile->Threads : std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+                Threads = std::min(Threads, Names->size());
+                Profile->Stop = false;
+                for (size_t Index = 0; Index < Threads; Index++)
+                {
+                    Profile->Workers.emplace_back([this, Names, Index, Threads]()
+                    {
+                        ::JNIEnv* Env = AttachCurrentThread(true, "jnihpp-preload");
+                        if (Env)
+                        {
+                            // Strided split, batches keep StopVM responsive
+                            std::vector<std::string> Batch;
+                            for (size_t i = Index; i < Names->size() && !Profile->Stop.load(std::memory_order_relaxed); i += Threads)
+                            {
+                                Batch.push_back((*Names)[i]);
+                                if (Batch.size() == 256)
+                                {
+                                    PreloadBatch(Env, Batch);
+                                    Batch.clear();
+                                }
+                            }
+                            PreloadBatch(Env, Batch);
+                            DetachCurrentThread();
+                        }
+                    });
+                }
+            }
+            // Loads (without initializing) a batch of classes with a single java call
+            jint PreloadBatch(::JNIEnv* Env, const std::vector<std::string>& Names)
+            {
+                jint Loaded = 0;
+                LocalFrame Frame(Env, 4);
+                jobjectArray JAVA_Names = Frame && !Names.empty() ? Env->NewObjectArray((jsize)Names.size(), jvt.JAVA_Cls_String, nullptr) : nullptr;
+                if (JAVA_Names)
+                {
+                    for (size_t i = 0; i < Names.size(); i++)
+                    {
+                        jstring JAVA_Name = NewString(Env, Names[i]);
+                        Env->SetObjectArrayElement(JAVA_Names, (jsize)i, JAVA_Name);
+                        Env->DeleteLocalRef(JAVA_Name);
+                    }
+                    Loaded = Env->CallStaticIntMethod(jvt.JAVA_Cls_ClassLoader, jvt.JAVA_Mth_ClassLoader_Preload, JAVA_Names);
+                }
+                return Loaded;
             }
 
             // Function that will load all java ref objects
             bool LoadAllJavaRefs()
             {
-                // === com.fuechsl.jnihpp.ClassLoadResult ===
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_NativClassLoadResult, JNIEnv->FindClass("com/fuechsl/jnihpp/ClassLoadResult"));
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Fld_NativClassLoadResult_Loaded, JNIEnv->GetFieldID(jvt.JAVA_Cls_NativClassLoadResult, "loaded", "Z"));
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Fld_NativClassLoadResult_Data, JNIEnv->GetFieldID(jvt.JAVA_Cls_NativClassLoadResult, "data", "[B"));
-                
+                ::JNIEnv* Env = GetEnv();
+
                 // === com.fuechsl.jnihpp.ClassLoader ===
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_ClassLoader, JNIEnv->FindClass("com/fuechsl/jnihpp/ClassLoader"));
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Fld_ClassLoader_InstanceId, JNIEnv->GetStaticFieldID(jvt.JAVA_Cls_ClassLoader, "nativeInstanceId", "J"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_ClassLoader, FindClassGlobal(Env, "com/fuechsl/jnihpp/ClassLoader"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Fld_ClassLoader_InstanceId, Env->GetStaticFieldID(jvt.JAVA_Cls_ClassLoader, "nativeInstanceId", "J"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_ClassLoader_DefineNativeClass, Env->GetMethodID(jvt.JAVA_Cls_ClassLoader, "DefineNativeClass", "(Ljava/lang/String;Ljava/nio/ByteBuffer;)Ljava/lang/Class;"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_ClassLoader_SetKnownClasses, Env->GetStaticMethodID(jvt.JAVA_Cls_ClassLoader, "SetKnownClasses", "([Ljava/lang/String;)V"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_ClassLoader_InvalidateClassCache, Env->GetStaticMethodID(jvt.JAVA_Cls_ClassLoader, "InvalidateClassCache", "(Ljava/lang/String;)V"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_ClassLoader_LoadClass, Env->GetStaticMethodID(jvt.JAVA_Cls_ClassLoader, "LoadClass", "(Ljava/lang/String;)Ljava/lang/Class;"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_ClassLoader_LoadClasses, Env->GetStaticMethodID(jvt.JAVA_Cls_ClassLoader, "LoadClasses", "([Ljava/lang/String;)[Ljava/lang/Class;"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_ClassLoader_Preload, Env->GetStaticMethodID(jvt.JAVA_Cls_ClassLoader, "Preload", "([Ljava/lang/String;)I"));
+
+                // === java.lang.String ===
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_String, FindClassGlobal(Env, "java/lang/String"));
 
                 // === com.fuechsl.jnihpp.Setup ===
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_Setup, JNIEnv->FindClass("com/fuechsl/jnihpp/Setup"));
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_Setup_RunSetup, JNIEnv->GetStaticMethodID(jvt.JAVA_Cls_Setup, "RunSetup", "(J)V"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_Setup, FindClassGlobal(Env, "com/fuechsl/jnihpp/Setup"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_Setup_RunSetup, Env->GetStaticMethodID(jvt.JAVA_Cls_Setup, "RunSetup", "(J)V"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_Setup_Flush, Env->GetStaticMethodID(jvt.JAVA_Cls_Setup, "Flush", "()V"));
 
-                // === com.fuechsl.jnihpp.NativePrintStream ===
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_NativePrintStream, JNIEnv->FindClass("com/fuechsl/jnihpp/NativePrintStream"));
+                // === com.fuechsl.jnihpp.NativeOutputStream ===
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_NativeOutputStream, FindClassGlobal(Env, "com/fuechsl/jnihpp/NativeOutputStream"));
 
                 // === com.fuechsl.jnihpp.NativeInputStream ===
-                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_NativeInputStream, JNIEnv->FindClass("com/fuechsl/jnihpp/NativeInputStream"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_NativeInputStream, FindClassGlobal(Env, "com/fuechsl/jnihpp/NativeInputStream"));
+
+                // === com.fuechsl.jnihpp.Channel ===
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_Channel, FindClassGlobal(Env, "com/fuechsl/jnihpp/Channel"));
+
+                // === com.fuechsl.jnihpp.reflection.ClassReflector ===
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_ClassReflector, FindClassGlobal(Env, "com/fuechsl/jnihpp/reflection/ClassReflector"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_ClassReflector_Export, Env->GetStaticMethodID(jvt.JAVA_Cls_ClassReflector, "Export", "(Ljava/lang/String;)[B"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_ClassReflector_HashClass, Env->GetStaticMethodID(jvt.JAVA_Cls_ClassReflector, "HashClass", "(Ljava/lang/String;)J"));
+
+                // === java.lang.Thread ===
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Cls_Thread, FindClassGlobal(Env, "java/lang/Thread"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_Thread_CurrentThread, Env->GetStaticMethodID(jvt.JAVA_Cls_Thread, "currentThread", "()Ljava/lang/Thread;"));
+                __JNIHPP_JNI_LOAD_AND_CHECK(jvt.JAVA_Mth_Thread_SetContextClassLoader, Env->GetMethodID(jvt.JAVA_Cls_Thread, "setContextClassLoader", "(Ljava/lang/ClassLoader;)V"));
+
+                // === java.lang.ClassLoader.getSystemClassLoader() (our com.fuechsl.jnihpp.ClassLoader) ===
+                {
+                    jclass JAVA_Cls_JavaClassLoader = Env->FindClass("java/lang/ClassLoader");
+                    jmethodID JAVA_Mth_GetSystemClassLoader = JAVA_Cls_JavaClassLoader ? Env->GetStaticMethodID(JAVA_Cls_JavaClassLoader, "getSystemClassLoader", "()Ljava/lang/ClassLoader;") : nullptr;
+                    jobject JAVA_Loader = JAVA_Mth_GetSystemClassLoader ? Env->CallStaticObjectMethod(JAVA_Cls_JavaClassLoader, JAVA_Mth_GetSystemClassLoader) : nullptr;
+                    if (JAVA_Loader)
+                    {
+                        jvt.JAVA_Obj_SystemClassLoader = Env->NewGlobalRef(JAVA_Loader);
+                        Env->DeleteLocalRef(JAVA_Loader);
+                    }
+                    if (JAVA_Cls_JavaClassLoader)
+                    {
+                        Env->DeleteLocalRef(JAVA_Cls_JavaClassLoader);
+                    }
+                    if (!jvt.JAVA_Obj_SystemClassLoader)
+                    {
+                        return false;
+                    }
+                }
 
                 // OK
                 return true;
             }
 
+            // FindClass promoted to a global ref (usable from every thread)
+            static jclass FindClassGlobal(::JNIEnv* Env, const char* Name)
+            {
+                jclass Global = nullptr;
+                jclass Local = Env->FindClass(Name);
+                if (Local)
+                {
+                    Global = (jclass)Env->NewGlobalRef(Local);
+                    Env->DeleteLocalRef(Local);
+                }
+
+                return Global;
+            }
+
+            // Sets the jni.hpp class loader as context loader of the calling thread
+            static void SetContextClassLoader(::JNIEnv* Env, const JAVA_Table& Table) noexcept
+            {
+                jobject JAVA_Thread = Env->CallStaticObjectMethod(Table.JAVA_Cls_Thread, Table.JAVA_Mth_Thread_CurrentThread);
+                if (JAVA_Thread)
+                {
+                    Env->CallVoidMethod(JAVA_Thread, Table.JAVA_Mth_Thread_SetContextClassLoader, Table.JAVA_Obj_SystemClassLoader);
+                    Env->DeleteLocalRef(JAVA_Thread);
+                }
+                Env->ExceptionClear();
+            }
+
             // Registers all the native functions
             bool RegisterNatives()
             {
-                // Array
-                std::array<JNINativeMethod, 8> NativeFunctions;
-                
+                ::JNIEnv* Env = GetEnv();
+
                 // === com.fuechsl.jnihpp.ClassLoader ===
+                NativeMethods ClassLoaderNatives(jvt.JAVA_Cls_ClassLoader);
                 // Functions for class loading by C++
-                NativeFunctions[0].name = (char*)"NLoadClassData";
-                NativeFunctions[0].signature = (char*)"(JLjava/lang/String;)Lcom/fuechsl/jnihpp/ClassLoadResult;";
-                NativeFunctions[0].fnPtr = &JAVA_NLoadClassData;
+                ClassLoaderNatives.Add("NDefineClass", "(JLcom/fuechsl/jnihpp/ClassLoader;Ljava/lang/String;)Ljava/lang/Class;", (void*)&JAVA_NDefineClass);
+                // Functions for resource loading by C++
+                ClassLoaderNatives.Add("NLoadResource", "(JLjava/lang/String;)Ljava/lang/Object;", (void*)&JAVA_NLoadResource);
+                ClassLoaderNatives.Add("NHasResource", "(JLjava/lang/String;)Z", (void*)&JAVA_NHasResource);
                 // Register natives (call)
-                __JNIHPP_JNI_CHECK_RESULT(JNIEnv->RegisterNatives(jvt.JAVA_Cls_ClassLoader, &NativeFunctions[0], 1));
+                if (!ClassLoaderNatives.Register(Env))
+                    return false;
 
-                // === com.fuechs.jnihpp.NativePrintStream ===
+                // === com.fuechs.jnihpp.NativeOutputStream ===
+                NativeMethods OutputStreamNatives(jvt.JAVA_Cls_NativeOutputStream);
                 // System.out.* callback
-                NativeFunctions[0].name = (char*)"NStdOut";
-                NativeFunctions[0].signature = (char*)"(JLjava/lang/String;)V";
-                NativeFunctions[0].fnPtr = &JAVA_NStdOut;
+                OutputStreamNatives.Add("NStdOut", "(JLjava/nio/ByteBuffer;I)V", (void*)&JAVA_NStdOut);
                 // System.err.* callback
-                NativeFunctions[1].name = (char*)"NStdErr";
-                NativeFunctions[1].signature = (char*)"(JLjava/lang/String;)V";
-                NativeFunctions[1].fnPtr = &JAVA_NStdErr;
+                OutputStreamNatives.Add("NStdErr", "(JLjava/nio/ByteBuffer;I)V", (void*)&JAVA_NStdErr);
                 // Register natives (call)
-                __JNIHPP_JNI_CHECK_RESULT(JNIEnv->RegisterNatives(jvt.JAVA_Cls_NativePrintStream, &NativeFunctions[0], 2));
+                if (!OutputStreamNatives.Register(Env))
+                    return false;
 
                 // === com.fuechs.jnihpp.NativeInputStream ===
+                NativeMethods InputStreamNatives(jvt.JAVA_Cls_NativeInputStream);
                 // System.in.* callback READ
-                NativeFunctions[0].name = (char*)"NReadByte";
-                NativeFunctions[0].signature = (char*)"(J)I";
-                NativeFunctions[0].fnPtr = &JAVA_NReadByte;
-                // System.in.* callback CANREAD
-                NativeFunctions[1].name = (char*)"NCanRead";
-                NativeFunctions[1].signature = (char*)"(J)Z";
-                NativeFunctions[1].fnPtr = &JAVA_NCanRead;
+                InputStreamNatives.Add("NRead", "(JLjava/nio/ByteBuffer;I)I", (void*)&JAVA_NRead);
+                // System.in.* callback AVAILABLE
+                InputStreamNatives.Add("NAvailable", "(J)I", (void*)&JAVA_NAvailable);
+                // Register natives (call)
+                if (!InputStreamNatives.Register(Env))
+                    return false;
+
+                // === com.fuechs.jnihpp.Channel ===
+                NativeMethods ChannelNatives(jvt.JAVA_Cls_Channel);
+                // Consumer sleep / wakeup (only called when the consumer is idle)
+                ChannelNatives.Add("NWait", "(Ljava/nio/ByteBuffer;)V", (void*)&Channel::JAVA_NWait);
+                ChannelNatives.Add("NWake", "(Ljava/nio/ByteBuffer;)V", (void*)&Channel::JAVA_NWake);
                 // Register natives (call)
-                __JNIHPP_JNI_CHECK_RESULT(JNIEnv->RegisterNatives(jvt.JAVA_Cls_NativeInputStream, &NativeFunctions[0], 2));
+                if (!ChannelNatives.Register(Env))
+                    return false;
 
                 // OK
                 return true;
@@ -397,135 +6011,428 @@ namespace jni
             // Sets up all required java class states
             bool SetupClassStates()
             {
+                ::JNIEnv* Env = GetEnv();
+
                 // Set native instance id
-                JNIEnv->SetStaticLongField(jvt.JAVA_Cls_ClassLoader, jvt.JAVA_Fld_ClassLoader_InstanceId, (jlong)this);
+                Env->SetStaticLongField(jvt.JAVA_Cls_ClassLoader, jvt.JAVA_Fld_ClassLoader_InstanceId, (jlong)this);
 
-                // Run setup function
-                JNIEnv->CallStaticVoidMethod(jvt.JAVA_Cls_Setup, jvt.JAVA_Mth_Setup_RunSetup, (jlong)this);
+                // Run setup function (a throwing setup fails the start)
+                Env->CallStaticVoidMethod(jvt.JAVA_Cls_Setup, jvt.JAVA_Mth_Setup_RunSetup, (jlong)this);
+                if (JavaException Error = TakeException(Env))
+                {
+                    ReportException(Env, Error);
+                    return false;
+                }
 
                 return true;
             }
 
-            // Callback for java --> native class loading
-            static jobject JAVA_NLoadClassData(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jstring JAVA_ClassName)
+            // Writes a java exception with its stack trace to SystemErr
+            void ReportException(::JNIEnv* Env, const JavaException& Error)
+            {
+                std::string Text = Error.Describe(Env);
+                if (!Text.empty())
+                {
+                    Text += '\n';
+                    SystemErr(Text.c_str(), Text.size());
+                }
+            }
+
+            // Callback for java --> native class loading (defines the class straight from native memory)
+            static jobject JAVA_NDefineClass(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jobject JAVA_Loader, jstring JAVA_ClassName)
             {
                 // Convert to instance pointer
                 JavaVM* Interface = (JavaVM*)JAVA_InstanceRef;
+                __JNIHPP_PROBE(Timing, DefineClass);
+
+                // Get string content
+                jobject JAVA_Class = nullptr;
+                MemoryBlock ClassContent;
+                {
+                    StringView ClassName(JAVA_Env, JAVA_ClassName);
+                    if (ClassName.Size())
+                    {
+                        // Call load class function
+                        ClassContent = Interface->LoadClassData(ClassName);
+                        __JNIHPP_PROBE_LABEL(Timing, ClassName.View());
+                        __JNIHPP_PROBE_HIT(Timing, ClassContent);
+                        __JNIHPP_PROBE_BYTES(Timing, ClassContent.GetSize());
 
-                // Create result object
-                jobject JAVA_LoadResult = JAVA_Env->AllocObject(Interface->jvt.JAVA_Cls_NativClassLoadResult);;
-                if (JAVA_LoadResult)
+                        // Startup profile training
+                        StartupProfile* Profile = Interface->Profile.get();
+                        if (ClassContent && Profile && Profile->Mode == StartupProfileMode::Train)
+                        {
+                            std::lock_guard<std::mutex> Lock(Profile->Mutex);
+                            Profile->Served.emplace_back(ClassName.View());
+                        }
+                    }
+                }
+                if (ClassContent)
                 {
-                    JAVA_Env->SetBooleanField(JAVA_LoadResult, Interface->jvt.JAVA_Fld_NativClassLoadResult_Loaded, false);
+                    // Wrap native memory (no copy) and let java define the class while the block is alive
+                    jobject JAVA_ClassBytes = JAVA_Env->NewDirectByteBuffer((void*)ClassContent.GetData(), (jlong)ClassContent.GetSize());
+                    if (JAVA_ClassBytes)
+                    {
+                        JAVA_Class = JAVA_Env->CallObjectMethod(JAVA_Loader, Interface->jvt.JAVA_Mth_ClassLoader_DefineNativeClass, JAVA_ClassName, JAVA_ClassBytes);
+
+                        // Delete local ref
+                        JAVA_Env->DeleteLocalRef(JAVA_ClassBytes);
+                    }
                 }
 
+                // Return class or null (ClassContent is released after java defined the class)
+                return JAVA_Class;
+            }
+            // Callback for java --> native resource loading (direct buffer for static memory, byte[] copy otherwise)
+            static jobject JAVA_NLoadResource(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jstring JAVA_ResourceName)
+            {
+                // Convert to instance pointer
+                JavaVM* Interface = (JavaVM*)JAVA_InstanceRef;
+                __JNIHPP_PROBE(Timing, LoadResource);
+
                 // Get string content
-                const char* ClassName = JAVA_Env->GetStringUTFChars(JAVA_ClassName, nullptr);
-                if (ClassName && JAVA_LoadResult)
+                jobject JAVA_Resource = nullptr;
+                MemoryBlock ResourceContent;
                 {
-                    // Convert to c++ string
-                    std::string ClassNameStd = ClassName;
-
-                    // Call load class function
-                    char* ClassContent = nullptr;
-                    jsize ClassContentSize = Interface->LoadClass(ClassName, &ClassContent);
-                    if (ClassContentSize)
+                    StringView ResourceName(JAVA_Env, JAVA_ResourceName);
+                    if (ResourceName.Size())
+                    {
+                        // Call load resource function
+                        ResourceContent = Interface->LoadResourceData(ResourceName);
+                        __JNIHPP_PROBE_LABEL(Timing, ResourceName.View());
+                        __JNIHPP_PROBE_HIT(Timing, ResourceContent.GetData());
+                        __JNIHPP_PROBE_BYTES(Timing, ResourceContent.GetSize());
+                    }
+                }
+                if (ResourceContent.GetData())
+                {
+                    if (ResourceContent.IsStatic())
+                    {
+                        // Memory outlives the stream: no copy
+                        JAVA_Resource = JAVA_Env->NewDirectByteBuffer((void*)ResourceContent.GetData(), (jlong)ResourceContent.GetSize());
+                    }
+                    else
                     {
-                        // Allocate a new byte array
-                        jbyteArray JAVA_ClassBytes = JAVA_Env->NewByteArray(ClassContentSize);
-                        if (JAVA_ClassBytes)
+                        // Memory is released after this call: copy
+                        jbyteArray JAVA_ResourceBytes = JAVA_Env->NewByteArray((jsize)ResourceContent.GetSize());
+                        if (JAVA_ResourceBytes)
                         {
-                            // Copy buffer to java
-                            JAVA_Env->SetByteArrayRegion(JAVA_ClassBytes, 0, ClassContentSize, (const jbyte*)ClassContent);
-
-                            // Setup Object properties
-                            JAVA_Env->SetBooleanField(JAVA_LoadResult, Interface->jvt.JAVA_Fld_NativClassLoadResult_Loaded, true);
-                            JAVA_Env->SetObjectField(JAVA_LoadResult, Interface->jvt.JAVA_Fld_NativClassLoadResult_Data, JAVA_ClassBytes);
+                            JAVA_Env->SetByteArrayRegion(JAVA_ResourceBytes, 0, (jsize)ResourceContent.GetSize(), (const jbyte*)ResourceContent.GetData());
                         }
-
-                        // Delete local ref
-                        if(JAVA_ClassBytes)
-                            JAVA_Env->DeleteLocalRef(JAVA_ClassBytes);
+                        JAVA_Resource = JAVA_ResourceBytes;
                     }
-                 
-                    // Free array using delete
-                    if (ClassContent)
-                        delete ClassContent;
                 }
 
-                // Delete ref
-                if (JAVA_LoadResult)
-                    JAVA_Env->DeleteLocalRef(JAVA_LoadResult);
+                // Return buffer (or null)
+                return JAVA_Resource;
+            }
+            // Callback for java --> native resource probing (nothing is handed to java)
+            static jboolean JAVA_NHasResource(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jstring JAVA_ResourceName)
+            {
+                // Convert to instance pointer
+                JavaVM* Interface = (JavaVM*)JAVA_InstanceRef;
 
-                // Return result object (or null)
-                return JAVA_LoadResult;
+                StringView ResourceName(JAVA_Env, JAVA_ResourceName);
+                return ResourceName.Size() && Interface->HasResource(ResourceName) ? JNI_TRUE : JNI_FALSE;
             }
-            // Callback for std::cout
-            static void JAVA_NStdOut(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jstring JAVA_Message)
+            // Callback for std::cout (one call per batch)
+            static void JAVA_NStdOut(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jobject JAVA_Buffer, jint JAVA_Length)
             {
                 // Convert to instance pointer
                 JavaVM* Interface = (JavaVM*)JAVA_InstanceRef;
+                __JNIHPP_PROBE(Timing, StdOut);
 
-                // Get message
-                const char* Message = JAVA_Env->GetStringUTFChars(JAVA_Message, nullptr);
-                if (Message)
+                // Read the batch directly from the java buffer
+                const char* Message = (const char*)JAVA_Env->GetDirectBufferAddress(JAVA_Buffer);
+                if (Message && JAVA_Length > 0)
                 {
                     // Send to callback
-                    Interface->SystemOut(Message);
-
-                    // Release message
-                    JAVA_Env->ReleaseStringUTFChars(JAVA_Message, Message);
+                    Interface->SystemOut(Message, (size_t)JAVA_Length);
+                    __JNIHPP_PROBE_BYTES(Timing, JAVA_Length);
                 }
             }
-            // Callback for std::cerr
-            static void JAVA_NStdErr(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jstring JAVA_Message)
+            // Callback for std::cerr (one call per batch)
+            static void JAVA_NStdErr(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jobject JAVA_Buffer, jint JAVA_Length)
             {
                 // Convert to instance pointer
                 JavaVM* Interface = (JavaVM*)JAVA_InstanceRef;
+                __JNIHPP_PROBE(Timing, StdErr);
 
-                // Get message
-                const char* Message = JAVA_Env->GetStringUTFChars(JAVA_Message, nullptr);
-                if (Message)
+                // Read the batch directly from the java buffer
+                const char* Message = (const char*)JAVA_Env->GetDirectBufferAddress(JAVA_Buffer);
+                if (Message && JAVA_Length > 0)
                 {
                     // Send to callback
-                    Interface->SystemErr(Message);
-
-                    // Release message
-                    JAVA_Env->ReleaseStringUTFChars(JAVA_Message, Message);
+                    Interface->SystemErr(Message, (size_t)JAVA_Length);
+                    __JNIHPP_PROBE_BYTES(Timing, JAVA_Length);
                 }
             }
-            // Callback for std::cin
-            static jint JAVA_NReadByte(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef)
+            // Callback for std::cin (fills the java buffer in one call)
+            static jint JAVA_NRead(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef, jobject JAVA_Buffer, jint JAVA_Max)
             {
                 // Convert to instance pointer
                 JavaVM* Interface = (JavaVM*)JAVA_InstanceRef;
+                __JNIHPP_PROBE(Timing, Read);
 
-                // Call virtual function to get a char
+                // Read directly into the java buffer
                 jint JavaReturn = -1;
-                unsigned char Value = 0x00;
-                if (Interface->SystemIn((char*)&Value))
+                char* Destination = (char*)JAVA_Env->GetDirectBufferAddress(JAVA_Buffer);
+                jlong Capacity = JAVA_Env->GetDirectBufferCapacity(JAVA_Buffer);
+                if (Destination && JAVA_Max > 0 && Capacity > 0)
                 {
-                    JavaReturn = Value;
+                    size_t Count = Interface->SystemInRead(Destination, (size_t)std::min<jlong>(JAVA_Max, Capacity));
+                    if (Count)
+                    {
+                        JavaReturn = (jint)Count;
+                        __JNIHPP_PROBE_BYTES(Timing, Count);
+                    }
                 }
 
                 return JavaReturn;
             }
             // Callback for checking std::cin
-            static jboolean JAVA_NCanRead(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef)
+            static jint JAVA_NAvailable(JNIEnv* JAVA_Env, jobject JAVA_This, jlong JAVA_InstanceRef)
             {
                 // Convert to instance pointer
                 JavaVM* Interface = (JavaVM*)JAVA_InstanceRef;
+                __JNIHPP_PROBE(Timing, Available);
+
+                // Clamp to java int
+                return (jint)std::min<size_t>(Interface->SystemInAvailable(), 0x7FFFFFFF);
+            }
+
+        private:
+            // Per thread env cache
+            struct ThreadState
+            {
+                ::JavaVM* VM = nullptr;
+                ::JNIEnv* Env = nullptr;
+                uint64_t Generation = 0;
+                bool Attached = false;
+
+                // Detaches at thread exit
+                ~ThreadState()
+                {
+                    Detach();
+                }
+
+                // Detach if attached by us and the vm is still the same (or currently waits for its threads in DestroyJavaVM)
+                void Detach() noexcept
+                {
+                    if (Attached && VM && (Generation == VMGeneration.load(std::memory_order_acquire) || Generation == DestroyingGeneration.load(std::memory_order_acquire)))
+                    {
+                        VM->DetachCurrentThread();
+                    }
+                    Forget();
+                }
 
-                // Call virtual function with nullptr to get if reading is possible
-                return Interface->SystemInCanRead();
+                // Drop without detaching
+                void Forget() noexcept
+                {
+                    VM = nullptr;
+                    Env = nullptr;
+                    Generation = 0;
+                    Attached = false;
+                }
+            };
+            static ThreadState& GetThreadState() noexcept
+            {
+                thread_local ThreadState State;
+                return State;
             }
 
+            // Stdin of the default SystemIn* callbacks (read straight from the descriptor, stdio buffering is bypassed)
+            class StdinBuffer
+            {
+                public:
+                    // Set once the default SystemIn(...) is used (SystemInRead may copy in bulk then)
+                    std::atomic<bool> InUse = false;
+
+                    // One char (blocks while nothing is buffered, false on EOF)
+                    bool Get(char* c)
+                    {
+                        std::lock_guard<std::mutex> Lock(Mutex);
+                        if (Begin == End && !Fill(true))
+                            return false;
+                        *c = Data[Begin++];
+                        return true;
+                    }
+                    // Buffered bytes plus what one non blocking read returns
+                    size_t Take(char* Destination, size_t Max)
+                    {
+                        std::lock_guard<std::mutex> Lock(Mutex);
+                        size_t Count = Copy(Destination, Max);
+                        if (Count < Max && Fill(false))
+                        {
+                            Count += Copy(Destination + Count, Max - Count);
+                        }
+                        return Count;
+                    }
+                    // Checks if a char can be read without blocking
+                    bool Poll()
+                    {
+                        std::lock_guard<std::mutex> Lock(Mutex);
+                        return Begin != End || Fill(false);
+                    }
+                    // Buffered bytes plus the bytes pending on the descriptor
+                    size_t Available()
+                    {
+                        std::lock_guard<std::mutex> Lock(Mutex);
+                        size_t Count = End - Begin;
+                        #if defined(_WIN32)
+                        DWORD Pending = 0;
+                        if (PeekNamedPipe(GetStdHandle(STD_INPUT_HANDLE), nullptr, 0, nullptr, &Pending, nullptr))
+                        {
+                            Count += (size_t)Pending;
+                        }
+                        #else
+                        int Pending = 0;
+                        if (ioctl(STDIN_FILENO, FIONREAD, &Pending) == 0 && Pending > 0)
+                        {
+                            Count += (size_t)Pending;
+                        }
+                        #endif
+                        return Count;
+                    }
+
+                private:
+                    size_t Copy(char* Destination, size_t Max) noexcept
+                    {
+                        size_t Count = std::min(Max, End - Begin);
+                        std::memcpy(Destination, Data + Begin, Count);
+                        Begin += Count;
+                        return Count;
+                    }
+                    // Refills the empty buffer with one read (Block = false only reads when that does not block)
+                    bool Fill(bool Block)
+                    {
+                        Begin = 0;
+                        End = 0;
+                        #if defined(_WIN32)
+                        HANDLE Input = GetStdHandle(STD_INPUT_HANDLE);
+                        if (!Block)
+                        {
+                            DWORD Type = GetFileType(Input);
+                            DWORD Pending = 0;
+                            if (Type == FILE_TYPE_PIPE ? !PeekNamedPipe(Input, nullptr, 0, nullptr, &Pending, nullptr) || !Pending : Type != FILE_TYPE_DISK)
+                                return false;
+                        }
+                        DWORD Count = 0;
+                        if (ReadFile(Input, Data, (DWORD)sizeof(Data), &Count, nullptr))
+                        {
+                            End = (size_t)Count;
+                        }
+                        #else
+                        if (!Block)
+                        {
+                            pollfd Descriptor = { STDIN_FILENO, POLLIN, 0 };
+                            if (poll(&Descriptor, 1, 0) <= 0 || !(Descriptor.revents & (POLLIN | POLLHUP)))
+                                return false;
+                        }
+                        ssize_t Count = 0;
+                        do
+                        {
+                            Count = read(STDIN_FILENO, Data, sizeof(Data));
+                        } while (Count < 0 && errno == EINTR);
+                        End = Count > 0 ? (size_t)Count : 0;
+                        #endif
+                        return End != 0;
+                    }
+
+                private:
+                    std::mutex Mutex;
+                    char Data[8192];
+                    size_t Begin = 0;
+                    size_t End = 0;
+            };
+            StdinBuffer Stdin;
+
+            // Bumped on every vm start / stop (invalidates all thread states)
+            static inline std::atomic<uint64_t> VMGeneration = 0;
+            // Generation of the vm inside DestroyJavaVM (0 if none)
+            static inline std::atomic<uint64_t> DestroyingGeneration = 0;
+
         private:
             // Java JNI and VM interface
             ::JavaVM* JVM = nullptr;
-            ::JNIEnv* JNIEnv = nullptr;
+            jint JNIVersion = 0;
+            bool AttachAsDaemon = true;
 
             // Java refs
             JAVA_Table jvt;
+
+            // Mapped class / resource archives
+            std::vector<ClassArchive> Archives;
+
+            // Shared class cache (exists while the vm runs)
+            std::unique_ptr<ClassCache> Classes;
+
+            // Reflected classes (memory and disk cache)
+            std::unique_ptr<ReflectionCache> Reflection = std::make_unique<ReflectionCache>();
+
+            // Startup profile state
+            struct StartupProfile
+            {
+                std::filesystem::path Directory;
+                StartupProfileMode Mode = StartupProfileMode::Replay;
+                size_t Threads = 0;
+
+                // Replay workers
+                std::atomic<bool> Stop = false;
+                std::vector<std::thread> Workers;
+
+                // Natively served classes (training)
+                std::mutex Mutex;
+                std::vector<std::string> Served;
+            };
+            std::unique_ptr<StartupProfile> Profile;
+
+            // Attached worker pool (created on first use)
+            std::unique_ptr<JavaExecutor> Executor;
+            std::mutex ExecutorMutex;
+    };
+
+    // Attaches the calling thread for the lifetime of the scope (detaches again unless the thread was attached before)
+    class ThreadScope
+    {
+        public:
+            // Construct
+            ThreadScope(JavaVM& VM, bool AsDaemon = false, const char* ThreadName = nullptr) noexcept :
+                VM(VM)
+            {
+                bool WasAttached = VM.IsCurrentThreadAttached();
+                Env = VM.AttachCurrentThread(AsDaemon, ThreadName);
+                OwnsAttachment = Env && !WasAttached;
+            }
+            ThreadScope(const ThreadScope&) = delete;
+            ThreadScope& operator=(const ThreadScope&) = delete;
+
+            // Destruct
+            ~ThreadScope()
+            {
+                if (OwnsAttachment)
+                {
+                    VM.DetachCurrentThread();
+                }
+            }
+
+            // JNIEnv of this thread (nullptr if attaching failed)
+            ::JNIEnv* operator->() const noexcept
+            {
+                return Env;
+            }
+            ::JNIEnv* GetEnv() const noexcept
+            {
+                return Env;
+            }
+            explicit operator bool() const noexcept
+            {
+                return Env != nullptr;
+            }
+
+        private:
+            JavaVM& VM;
+            ::JNIEnv* Env = nullptr;
+            bool OwnsAttachment = false;
     };
 }
@@ -0,0 +1,52 @@
+package com.fuechsl.jnihpp;
+
+import java.io.InputStream;
+import java.nio.ByteBuffer;
+import java.util.Objects;
+
+/***
+ * Input stream that reads from a (direct) byte buffer without copying it first
+ * @author Ludwig Fuechsl
+ */
+public class ByteBufferInputStream extends InputStream {
+	// Source buffer
+	private final ByteBuffer buffer;
+	
+	/***
+	 * Constructor
+	 * @param buffer Buffer to be read (from its position to its limit)
+	 */
+	public ByteBufferInputStream(ByteBuffer buffer) {
+		this.buffer = buffer;
+	}
+	
+	@Override
+	public synchronized int read() {
+		return buffer.hasRemaining() ? buffer.get() & 0xFF : -1;
+	}
+	
+	@Override
+	public synchronized int read(byte[] b, int off, int len) {
+		Objects.checkFromIndexSize(off, len, b.length);
+		if(len == 0)
+			return 0;
+		if(!buffer.hasRemaining())
+			return -1;
+		
+		int count = Math.min(len, buffer.remaining());
+		buffer.get(b, off, count);
+		return count;
+	}
+	
+	@Override
+	public synchronized long skip(long n) {
+		int count = (int)Math.max(Math.min(n, buffer.remaining()), 0);
+		buffer.position(buffer.position() + count);
+		return count;
+	}
+	
+	@Override
+	public synchronized int available() {
+		return buffer.remaining();
+	}
+}
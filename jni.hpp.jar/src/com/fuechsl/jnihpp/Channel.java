@@ -0,0 +1,200 @@
+package com.fuechsl.jnihpp;
+
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/***
+ * Lock free ring buffer of framed records shared with C++ (memory is owned by jni::Channel)
+ * Any number of producers and a single consumer, on either side, no native call per record
+ * @author Ludwig Fuechsl
+ */
+public final class Channel {
+	// Layout (must match jni::Channel)
+	private static final int CACHE_LINE = 64;
+	private static final int CAPACITY_OFFSET = 0;
+	private static final int FLAGS_OFFSET = 8;
+	private static final int WRITE_OFFSET = CACHE_LINE;
+	private static final int READ_OFFSET = 2 * CACHE_LINE;
+	private static final int WAITING_OFFSET = 3 * CACHE_LINE;
+	private static final int HEADER_SIZE = 4 * CACHE_LINE;
+	private static final int RECORD_HEADER_SIZE = 8;
+	private static final int FLAG_MULTI_PRODUCER = 1;
+	
+	// Atomic access to the shared memory
+	private static final VarHandle LONGS = MethodHandles.byteBufferViewVarHandle(long[].class, ByteOrder.nativeOrder());
+	private static final VarHandle INTS = MethodHandles.byteBufferViewVarHandle(int[].class, ByteOrder.nativeOrder());
+	private static final VarHandle ARRAY_LONGS = MethodHandles.byteArrayViewVarHandle(long[].class, ByteOrder.nativeOrder());
+	
+	/***
+	 * Receives records (the payload is only valid during the call)
+	 */
+	public interface Handler {
+		void OnRecord(int type, ByteBuffer buffer, int offset, int length);
+	}
+	
+	// Shared memory (native order) and a read only view for handlers
+	private final ByteBuffer buffer;
+	private final ByteBuffer view;
+	private final int capacity;
+	private final boolean multiProducer;
+	
+	/***
+	 * Constructor
+	 * @param buffer Direct buffer created by jni::Channel::NewBuffer (valid while the C++ channel lives, capacity at most 1 << 30)
+	 */
+	public Channel(ByteBuffer buffer) {
+		this.buffer = buffer.duplicate().order(ByteOrder.nativeOrder());
+		this.view = this.buffer.asReadOnlyBuffer().order(ByteOrder.nativeOrder());
+		this.capacity = (int)this.buffer.getLong(CAPACITY_OFFSET);
+		this.multiProducer = (this.buffer.getInt(FLAGS_OFFSET) & FLAG_MULTI_PRODUCER) != 0;
+	}
+	
+	/***
+	 * Largest payload a single record can carry
+	 */
+	public int MaxPayload() {
+		return capacity / 2 - RECORD_HEADER_SIZE;
+	}
+	
+	/***
+	 * Appends a record
+	 * @param type User defined record type
+	 * @param data Payload source
+	 * @param offset Payload start
+	 * @param length Payload size
+	 * @return False when the channel is full or the payload too large
+	 */
+	public boolean Write(int type, byte[] data, int offset, int length) {
+		if(length < 0 || length > MaxPayload() || offset < 0 || offset + length > data.length)
+			return false;
+		
+		// Reserve (record must be contiguous, the rest of the ring is skipped otherwise)
+		long recordSize = Align(RECORD_HEADER_SIZE + length);
+		long position = (long)LONGS.getOpaque(buffer, WRITE_OFFSET);
+		long padding;
+		while(true) {
+			int index = (int)(position & (capacity - 1));
+			padding = index + recordSize > capacity ? capacity - index : 0;
+			if(position + padding + recordSize - (long)LONGS.getAcquire(buffer, READ_OFFSET) > capacity)
+				return false;
+			if(!multiProducer) {
+				LONGS.setOpaque(buffer, WRITE_OFFSET, position + padding + recordSize);
+				break;
+			}
+			long witness = (long)LONGS.compareAndExchange(buffer, WRITE_OFFSET, position, position + padding + recordSize);
+			if(witness == position)
+				break;
+			position = witness;
+		}
+		
+		// Skip marker
+		if(padding != 0)
+			INTS.setRelease(buffer, HEADER_SIZE + (int)(position & (capacity - 1)), (int)-padding);
+		
+		// Payload first, length last
+		int record = HEADER_SIZE + (int)((position + padding) & (capacity - 1));
+		buffer.putInt(record + 4, type);
+		int copied = 0;
+		for(; copied + 8 <= length; copied += 8)
+			buffer.putLong(record + RECORD_HEADER_SIZE + copied, (long)ARRAY_LONGS.get(data, offset + copied));
+		for(; copied < length; copied++)
+			buffer.put(record + RECORD_HEADER_SIZE + copied, data[offset + copied]);
+		INTS.setRelease(buffer, record, RECORD_HEADER_SIZE + length);
+		
+		// Wake the consumer only when it sleeps
+		VarHandle.fullFence();
+		if((int)INTS.getOpaque(buffer, WAITING_OFFSET) != 0)
+			NWake(buffer);
+		return true;
+	}
+	
+	/***
+	 * Appends a record
+	 * @param type User defined record type
+	 * @param data Payload
+	 * @return False when the channel is full or the payload too large
+	 */
+	public boolean Write(int type, byte[] data) {
+		return Write(type, data, 0, data.length);
+	}
+	
+	/***
+	 * Consumes records (single consumer only)
+	 * @param handler Receives each record
+	 * @param max Maximum number of records
+	 * @return Number of records consumed
+	 */
+	public int Read(Handler handler, int max) {
+		long start = (long)LONGS.getOpaque(buffer, READ_OFFSET);
+		long position = start;
+		int count = 0;
+		
+		// At most one lap per call (the consumed memory is cleared on return)
+		while(count < max && position - start < capacity) {
+			int index = HEADER_SIZE + (int)(position & (capacity - 1));
+			int length = (int)INTS.getAcquire(buffer, index);
+			if(length == 0)
+				break;
+			if(length < 0) {
+				position += -length;
+				continue;
+			}
+			
+			handler.OnRecord(buffer.getInt(index + 4), view, index + RECORD_HEADER_SIZE, length - RECORD_HEADER_SIZE);
+			position += Align(length);
+			count++;
+		}
+		
+		// Clear consumed memory (uncommitted records must read as length 0) and hand it back
+		if(position != start) {
+			for(long clear = start; clear < position; clear += 8)
+				buffer.putLong(HEADER_SIZE + (int)(clear & (capacity - 1)), 0L);
+			LONGS.setRelease(buffer, READ_OFFSET, position);
+		}
+		return count;
+	}
+	
+	/***
+	 * Checks if a committed record is ready
+	 */
+	public boolean IsEmpty() {
+		long position = (long)LONGS.getAcquire(buffer, READ_OFFSET);
+		return (int)INTS.getAcquire(buffer, HEADER_SIZE + (int)(position & (capacity - 1))) == 0;
+	}
+	
+	/***
+	 * Blocks the consumer until a record is ready or Wake() is called
+	 */
+	public void Await() {
+		INTS.setVolatile(buffer, WAITING_OFFSET, 1);
+		VarHandle.fullFence();
+		if(IsEmpty())
+			NWait(buffer);
+		INTS.setOpaque(buffer, WAITING_OFFSET, 0);
+	}
+	
+	/***
+	 * Wakes a waiting consumer
+	 */
+	public void Wake() {
+		NWake(buffer);
+	}
+	
+	private static long Align(long size) {
+		return (size + 7) & ~7L;
+	}
+	
+	/***
+	 * Sleeps while the waiting flag is set (futex style)
+	 * @param buffer Channel memory
+	 */
+	private static native void NWait(ByteBuffer buffer);
+	
+	/***
+	 * Clears the waiting flag and wakes the consumer
+	 * @param buffer Channel memory
+	 */
+	private static native void NWake(ByteBuffer buffer);
+}
@@ -1,10 +0,0 @@
-package com.fuechsl.jnihpp;
-
-/***
- * Native class loading result descriptor
- * @author Ludwig Fuechsl
- */
-public class ClassLoadResult {
-	public boolean loaded = false;
-	public byte[] data = null;
-}
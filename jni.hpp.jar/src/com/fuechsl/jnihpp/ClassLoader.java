@@ -1,5 +1,20 @@
 package com.fuechsl.jnihpp;
 
+import java.io.FileNotFoundException;
+import java.io.IOException;
+import java.io.InputStream;
+import java.net.MalformedURLException;
+import java.net.URL;
+import java.net.URLConnection;
+import java.net.URLStreamHandler;
+import java.nio.ByteBuffer;
+import java.security.ProtectionDomain;
+import java.util.Collections;
+import java.util.Enumeration;
+import java.util.HashSet;
+import java.util.Set;
+import java.util.concurrent.ConcurrentHashMap;
+
 /***
  * Custom class loader that calls C++ (
  * @author Ludwig Fuechsl
@@ -8,6 +23,34 @@ public class ClassLoader extends java.lang.ClassLoader {
 	// Instance ID of the native jvm class to be called (aka. a pointer that you shall never touch!)
 	private static long nativeInstanceId = 0;
 	
+	// Names that C++ could not deliver (misses never leave java twice)
+	private static final Set<String> missingClasses = ConcurrentHashMap.newKeySet();
+	
+	// Optional complete set of names C++ can deliver (null = unknown, ask C++)
+	private static volatile Set<String> knownClasses = null;
+	
+	// Protocol of URLs pointing to native resources
+	public static final String RESOURCE_PROTOCOL = "jnihpp";
+	
+	// Handler that opens native resources
+	private static final URLStreamHandler resourceHandler = new URLStreamHandler() {
+		@Override
+		protected URLConnection openConnection(URL url) {
+			return new URLConnection(url) {
+				@Override
+				public void connect() {}
+				
+				@Override
+				public InputStream getInputStream() throws IOException {
+					InputStream stream = OpenNativeResource(url.getPath().substring(1));
+					if(stream == null)
+						throw new FileNotFoundException(url.toString());
+					return stream;
+				}
+			};
+		}
+	};
+	
 	/***
 	 * Constructor
 	 */
@@ -19,28 +62,169 @@ public class ClassLoader extends java.lang.ClassLoader {
 	protected Class<?> findClass(String name) throws ClassNotFoundException {
 		Class<?> cls = null;
 		
-		// Do custom loading
-		if(nativeInstanceId != 0){
-			ClassLoadResult result = NLoadClassData(nativeInstanceId, name);
-			if(result.loaded){
-				// Craft class
-				cls = defineClass(name, result.data, 0, result.data.length);
+		// Do custom loading (C++ defines the class from its own memory)
+		Set<String> known = knownClasses;
+		if(nativeInstanceId != 0 && !missingClasses.contains(name) && (known == null || known.contains(name))){
+			cls = NDefineClass(nativeInstanceId, this, name);
+			if(cls == null) {
+				missingClasses.add(name);
 			}
 		}
 		
 		// Throw if the class was not found
 		if(cls == null) {
-			throw new ClassNotFoundException("Failed to load the class using the default java classloader and the C++ Native interface");
+			throw new NativeClassNotFoundException(name);
 		}
 		
 		return cls;
 	}
 	
+	/***
+	 * Sets the complete list of classes C++ can deliver (called from C++)
+	 * @param names Class names (binary names) or null when unknown
+	 */
+	public static void SetKnownClasses(String[] names) {
+		Set<String> known = null;
+		if(names != null) {
+			known = new HashSet<>(names.length * 2);
+			Collections.addAll(known, names);
+			known = Collections.unmodifiableSet(known);
+		}
+		knownClasses = known;
+		missingClasses.clear();
+	}
+	
+	/***
+	 * Forgets cached misses (called from C++)
+	 * @param name Class name or null for all
+	 */
+	public static void InvalidateClassCache(String name) {
+		if(name == null)
+			missingClasses.clear();
+		else
+			missingClasses.remove(name);
+	}
+	
+	/***
+	 * Resolves a class through the system class loader (called from C++)
+	 * @param name Binary or internal name ("com.foo.Bar", "com/foo/Bar", "[I")
+	 * @return Class or null
+	 */
+	public static Class<?> LoadClass(String name) {
+		try {
+			return Class.forName(name.replace('/', '.'), false, java.lang.ClassLoader.getSystemClassLoader());
+		}
+		catch(ClassNotFoundException | LinkageError e) {
+			return null;
+		}
+	}
+	
+	/***
+	 * Resolves many classes with a single call (called from C++)
+	 * @param names Binary or internal names
+	 * @return Classes in the same order (null for missing classes)
+	 */
+	public static Class<?>[] LoadClasses(String[] names) {
+		Class<?>[] classes = new Class<?>[names.length];
+		for(int i = 0; i < names.length; i++) {
+			classes[i] = LoadClass(names[i]);
+		}
+		return classes;
+	}
+	
+	/***
+	 * Loads classes without initializing them (startup profile replay, called from C++)
+	 * @param names Binary names
+	 * @return Number of classes found
+	 */
+	public static int Preload(String[] names) {
+		int count = 0;
+		for(String name : names) {
+			if(LoadClass(name) != null)
+				count++;
+		}
+		return count;
+	}
+	
+	@Override
+	protected URL findResource(String name) {
+		URL url = null;
+		
+		// Probe C++ (nothing is copied) and hand out a URL that streams from native memory when opened
+		if(nativeInstanceId != 0 && NHasResource(nativeInstanceId, name)) {
+			try {
+				url = new URL(RESOURCE_PROTOCOL, null, -1, "/" + name, resourceHandler);
+			}
+			catch(MalformedURLException e) {
+				url = null;
+			}
+		}
+		
+		return url;
+	}
+	
+	@Override
+	protected Enumeration<URL> findResources(String name) {
+		URL url = findResource(name);
+		return url == null ? Collections.emptyEnumeration() : Collections.enumeration(Collections.singletonList(url));
+	}
+	
+	@Override
+	public InputStream getResourceAsStream(String name) {
+		// Parent first, then directly from C++ (skipping the URL round trip)
+		InputStream stream = getParent() != null ? getParent().getResourceAsStream(name) : null;
+		if(stream == null) {
+			stream = OpenNativeResource(name);
+		}
+		return stream;
+	}
+	
+	/***
+	 * Opens a resource served by C++
+	 * @param name Resource path ("com/foo/bar.txt")
+	 * @return Stream over the resource or null
+	 */
+	private static InputStream OpenNativeResource(String name) {
+		Object data = nativeInstanceId != 0 ? NLoadResource(nativeInstanceId, name) : null;
+		if(data instanceof ByteBuffer)
+			return new ByteBufferInputStream(((ByteBuffer)data).asReadOnlyBuffer());
+		if(data instanceof byte[])
+			return new ByteBufferInputStream(ByteBuffer.wrap((byte[])data));
+		return null;
+	}
+	
+	/***
+	 * Called from C++ while the native class bytes are alive
+	 * @param name Name of the class
+	 * @param data Direct buffer over the native class bytes (only valid during this call)
+	 * @return Defined class
+	 */
+	private Class<?> DefineNativeClass(String name, ByteBuffer data) {
+		return defineClass(name, data, (ProtectionDomain)null);
+	}
+	
 	/***
 	 * 
 	 * @param instance Instance ID of the JavaVM instance object that shall receive the call
+	 * @param loader Loader the class shall be defined in
 	 * @param name Name of the class that should be found
-	 * @return ClassLoadResult containing the required data
+	 * @return Defined class or null
+	 */
+	public static native Class<?> NDefineClass(long instance, ClassLoader loader, String name);
+	
+	/***
+	 * 
+	 * @param instance Instance ID of the JavaVM instance object that shall receive the call
+	 * @param name Path of the resource ("com/foo/bar.txt")
+	 * @return Direct ByteBuffer over native memory, byte[] copy or null
+	 */
+	public static native Object NLoadResource(long instance, String name);
+	
+	/***
+	 * 
+	 * @param instance Instance ID of the JavaVM instance object that shall receive the call
+	 * @param name Path of the resource ("com/foo/bar.txt")
+	 * @return True when C++ can deliver the resource
 	 */
-	public static native ClassLoadResult NLoadClassData(long instance, String name);
+	public static native boolean NHasResource(long instance, String name);
 }
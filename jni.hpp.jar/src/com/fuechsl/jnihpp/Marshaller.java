@@ -0,0 +1,265 @@
+package com.fuechsl.jnihpp;
+
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.lang.reflect.Field;
+import java.lang.reflect.Modifier;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/***
+ * Copies primitive fields of many objects from / to one native buffer (created by jni::StructMapping)
+ * Rows: field i of object n is at offsets[i] + n * stride (C++ array of structs)
+ * Columns: field i of object n is at ColumnStart(i, count) + n * size(i) (C++ struct of arrays)
+ * @author Ludwig Fuechsl
+ */
+public final class Marshaller {
+	// Column alignment (must match jni::StructMapping)
+	private static final int COLUMN_ALIGNMENT = 64;
+	
+	// Resolved field handles and their native layout
+	private final VarHandle[] fields;
+	private final char[] types;
+	private final int[] sizes;
+	private final int[] offsets;
+	private final int stride;
+	
+	private Marshaller(VarHandle[] fields, char[] types, int[] offsets, int stride) {
+		this.fields = fields;
+		this.types = types;
+		this.offsets = offsets;
+		this.stride = stride;
+		this.sizes = new int[types.length];
+		for(int i = 0; i < types.length; i++) {
+			sizes[i] = Size(types[i]);
+		}
+	}
+	
+	/***
+	 * Resolves the fields once (called from C++)
+	 * @param cls Class of the objects
+	 * @param names Field names
+	 * @param descriptors Primitive descriptor of each field ("IJD")
+	 * @param offsets Offset of each field in the C++ struct
+	 * @param stride Size of the C++ struct
+	 * @return Marshaller or null when a field is missing, static or of another type
+	 */
+	public static Marshaller Create(Class<?> cls, String[] names, String descriptors, int[] offsets, int stride) {
+		if(names.length != descriptors.length() || names.length != offsets.length)
+			return null;
+		
+		VarHandle[] fields = new VarHandle[names.length];
+		char[] types = descriptors.toCharArray();
+		try {
+			// One var handle per field (no access checks and no boxing in the copy loops)
+			MethodHandles.Lookup lookup = MethodHandles.lookup();
+			for(int i = 0; i < names.length; i++) {
+				Field field = FindField(cls, names[i]);
+				if(field == null || Modifier.isStatic(field.getModifiers()) || !field.getType().isPrimitive() || Descriptor(field.getType()) != types[i])
+					return null;
+				fields[i] = MethodHandles.privateLookupIn(field.getDeclaringClass(), lookup).unreflectVarHandle(field);
+			}
+		}
+		catch(IllegalAccessException | RuntimeException e) {
+			// Inaccessible (module encapsulation)
+			return null;
+		}
+		return new Marshaller(fields, types, offsets, stride);
+	}
+	
+	/***
+	 * Copies objects[start, start + count) into the buffer (null objects are zeroed)
+	 * @param objects Source objects
+	 * @param start First object
+	 * @param count Number of objects
+	 * @param buffer Direct buffer over the C++ memory
+	 * @param columns Struct of arrays layout instead of rows
+	 * @return Number of objects copied (-1 on a type mismatch)
+	 */
+	public int Pack(Object[] objects, int start, int count, ByteBuffer buffer, boolean columns) {
+		ByteBuffer target = buffer.order(ByteOrder.nativeOrder());
+		try {
+			// Field outer: each field streams through one column (or one slot per row) in a loop of its own type
+			int column = 0;
+			for(int f = 0; f < fields.length; f++) {
+				VarHandle field = fields[f];
+				int position = columns ? column : offsets[f];
+				int step = columns ? sizes[f] : stride;
+				int end = start + count;
+				switch(types[f]) {
+					case 'Z':
+						for(int n = start; n < end; n++, position += step) {
+							Object object = objects[n];
+							target.put(position, (byte)(object != null && (boolean)field.get(object) ? 1 : 0));
+						}
+						break;
+					case 'B':
+						for(int n = start; n < end; n++, position += step) {
+							Object object = objects[n];
+							target.put(position, object != null ? (byte)field.get(object) : 0);
+						}
+						break;
+					case 'C':
+						for(int n = start; n < end; n++, position += step) {
+							Object object = objects[n];
+							target.putChar(position, object != null ? (char)field.get(object) : 0);
+						}
+						break;
+					case 'S':
+						for(int n = start; n < end; n++, position += step) {
+							Object object = objects[n];
+							target.putShort(position, object != null ? (short)field.get(object) : 0);
+						}
+						break;
+					case 'I':
+						for(int n = start; n < end; n++, position += step) {
+							Object object = objects[n];
+							target.putInt(position, object != null ? (int)field.get(object) : 0);
+						}
+						break;
+					case 'J':
+						for(int n = start; n < end; n++, position += step) {
+							Object object = objects[n];
+							target.putLong(position, object != null ? (long)field.get(object) : 0);
+						}
+						break;
+					case 'F':
+						for(int n = start; n < end; n++, position += step) {
+							Object object = objects[n];
+							target.putFloat(position, object != null ? (float)field.get(object) : 0);
+						}
+						break;
+					case 'D':
+						for(int n = start; n < end; n++, position += step) {
+							Object object = objects[n];
+							target.putDouble(position, object != null ? (double)field.get(object) : 0);
+						}
+						break;
+				}
+				column = ColumnEnd(column, sizes[f], count);
+			}
+		}
+		catch(ClassCastException e) {
+			return -1;
+		}
+		return count;
+	}
+	
+	/***
+	 * Writes the buffer back into objects[start, start + count) (null objects are skipped)
+	 * @param objects Target objects
+	 * @param start First object
+	 * @param count Number of objects
+	 * @param buffer Direct buffer over the C++ memory
+	 * @param columns Struct of arrays layout instead of rows
+	 * @return Number of objects written (-1 when a field cannot be written)
+	 */
+	public int Unpack(Object[] objects, int start, int count, ByteBuffer buffer, boolean columns) {
+		ByteBuffer source = buffer.order(ByteOrder.nativeOrder());
+		try {
+			int column = 0;
+			for(int f = 0; f < fields.length; f++) {
+				VarHandle field = fields[f];
+				int position = columns ? column : offsets[f];
+				int step = columns ? sizes[f] : stride;
+				int end = start + count;
+				switch(types[f]) {
+					case 'Z':
+						for(int n = start; n < end; n++, position += step) {
+							if(objects[n] != null)
+								field.set(objects[n], source.get(position) != 0);
+						}
+						break;
+					case 'B':
+						for(int n = start; n < end; n++, position += step) {
+							if(objects[n] != null)
+								field.set(objects[n], source.get(position));
+						}
+						break;
+					case 'C':
+						for(int n = start; n < end; n++, position += step) {
+							if(objects[n] != null)
+								field.set(objects[n], source.getChar(position));
+						}
+						break;
+					case 'S':
+						for(int n = start; n < end; n++, position += step) {
+							if(objects[n] != null)
+								field.set(objects[n], source.getShort(position));
+						}
+						break;
+					case 'I':
+						for(int n = start; n < end; n++, position += step) {
+							if(objects[n] != null)
+								field.set(objects[n], source.getInt(position));
+						}
+						break;
+					case 'J':
+						for(int n = start; n < end; n++, position += step) {
+							if(objects[n] != null)
+								field.set(objects[n], source.getLong(position));
+						}
+						break;
+					case 'F':
+						for(int n = start; n < end; n++, position += step) {
+							if(objects[n] != null)
+								field.set(objects[n], source.getFloat(position));
+						}
+						break;
+					case 'D':
+						for(int n = start; n < end; n++, position += step) {
+							if(objects[n] != null)
+								field.set(objects[n], source.getDouble(position));
+						}
+						break;
+				}
+				column = ColumnEnd(column, sizes[f], count);
+			}
+		}
+		catch(ClassCastException | UnsupportedOperationException e) {
+			// Object of another class or a final field
+			return -1;
+		}
+		return count;
+	}
+	
+	// Start of the next column
+	private static int ColumnEnd(int column, int size, int count) {
+		int end = column + size * count;
+		return (end + COLUMN_ALIGNMENT - 1) & ~(COLUMN_ALIGNMENT - 1);
+	}
+	
+	// Declared field of the class or one of its superclasses
+	private static Field FindField(Class<?> cls, String name) {
+		for(Class<?> current = cls; current != null; current = current.getSuperclass()) {
+			try {
+				return current.getDeclaredField(name);
+			}
+			catch(NoSuchFieldException e) {
+				continue;
+			}
+		}
+		return null;
+	}
+	
+	private static char Descriptor(Class<?> type) {
+		if(type == boolean.class) return 'Z';
+		if(type == byte.class) return 'B';
+		if(type == char.class) return 'C';
+		if(type == short.class) return 'S';
+		if(type == int.class) return 'I';
+		if(type == long.class) return 'J';
+		if(type == float.class) return 'F';
+		if(type == double.class) return 'D';
+		return 'V';
+	}
+	
+	private static int Size(char type) {
+		switch(type) {
+			case 'Z': case 'B': return 1;
+			case 'C': case 'S': return 2;
+			case 'I': case 'F': return 4;
+			default: return 8;
+		}
+	}
+}
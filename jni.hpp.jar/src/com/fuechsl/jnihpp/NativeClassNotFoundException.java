@@ -0,0 +1,23 @@
+package com.fuechsl.jnihpp;
+
+/***
+ * ClassNotFoundException thrown for native misses (skips the expensive stack trace filling)
+ * @author Ludwig Fuechsl
+ */
+public class NativeClassNotFoundException extends ClassNotFoundException {
+	private static final long serialVersionUID = 1L;
+	
+	/***
+	 * Constructor
+	 * @param name Name of the class that was not found
+	 */
+	public NativeClassNotFoundException(String name) {
+		super(name);
+	}
+	
+	@Override
+	public synchronized Throwable fillInStackTrace() {
+		// Misses are expected (optional integrations, BeanInfo probing, ...) no stack trace required
+		return this;
+	}
+}
@@ -2,6 +2,7 @@ package com.fuechsl.jnihpp;
 
 import java.io.IOException;
 import java.io.InputStream;
+import java.nio.ByteBuffer;
 import java.util.Objects;
 
 /***
@@ -9,88 +10,109 @@ import java.util.Objects;
  * @author Ludwig Fuechsl
  */
 public class NativeInputStream extends InputStream {
+	// Default size of the read buffer
+	public static final int DEFAULT_BUFFER = 8192;
+	
 	// Don't touch this
 	private long instanceID = 0;
 	
+	// Direct buffer filled by C++ in one call (position = next byte, limit = end of data)
+	private final ByteBuffer buffer;
+	
 	/***
 	 * Constructor
 	 * @param instanceID Pointer to JavaVM
 	 */
 	public NativeInputStream(long instanceID){
+		this(instanceID, DEFAULT_BUFFER);
+	}
+	
+	/***
+	 * Constructor
+	 * @param instanceID Pointer to JavaVM
+	 * @param capacity Size of the read buffer in bytes
+	 */
+	public NativeInputStream(long instanceID, int capacity){
 		this.instanceID = instanceID;
+		this.buffer = ByteBuffer.allocateDirect(Math.max(capacity, 1));
+		this.buffer.limit(0);
 	}
 	
 	@Override
-	public int read() throws IOException {
-		return NReadByte(instanceID);
+	public synchronized int read() throws IOException {
+		if(!buffer.hasRemaining() && !fill())
+			return -1;
+		
+		return buffer.get() & 0xFF;
 	}
 	
 	@Override
-	public int read(byte[] b, int off, int len) throws IOException {
+	public synchronized int read(byte[] b, int off, int len) throws IOException {
 		Objects.checkFromIndexSize(off, len, b.length);
-		int nread = 0;
+		if(len == 0)
+			return 0;
+		
+		// Block for the first batch only
+		if(!buffer.hasRemaining() && !fill())
+			return -1;
 		
-		if(len > 0)
-		{
-			// Read first char blocking
-			int val1 = read();
-			if(val1 != -1)
-			{
-				b[off] = (byte)val1;
-				int i = 1;
-				for(; i < len; i++)
-				{
-					// Stop when no data is available
-					if(available() == 0)
-						break;
-					
-					// Read
-					int vali = read();
-					
-					// Stop on EOF
-					if(vali == -1)
-						break;
-					
-					// Store
-					b[off + i] = (byte)vali;
-				}
-				nread = i;
-			}
+		int nread = Math.min(len, buffer.remaining());
+		buffer.get(b, off, nread);
+		
+		// Take whatever C++ can deliver without blocking
+		while(nread < len && NAvailable(instanceID) > 0 && fill()) {
+			int count = Math.min(len - nread, buffer.remaining());
+			buffer.get(b, off + nread, count);
+			nread += count;
 		}
 		
 		return nread;
 	}
 
 	@Override
-	public int available() throws IOException {
-		return NCanRead(instanceID) ? 1 : 0;
+	public synchronized int available() throws IOException {
+		return (int)Math.min((long)buffer.remaining() + NAvailable(instanceID), Integer.MAX_VALUE);
 	}
 	
 	@Override
-	public long skip(long n) throws IOException {
-		// Custom fast skip
+	public synchronized long skip(long n) throws IOException {
+		// Drop buffered data and refill in bulk
 		long remaining = n;
-        for (;remaining > 0; remaining--) {
-            int nr = read();
-            if (nr < 0) {
-                break;
-            }
-        }
-        return n - remaining;
+		while(remaining > 0) {
+			if(!buffer.hasRemaining() && !fill())
+				break;
+			
+			int count = (int)Math.min(remaining, buffer.remaining());
+			buffer.position(buffer.position() + count);
+			remaining -= count;
+		}
+		return n - remaining;
 	}
 	
+	/***
+	 * Refills the buffer from C++ (blocking)
+	 * @return False on EOF
+	 */
+	private boolean fill() {
+		buffer.clear();
+		int count = NRead(instanceID, buffer, buffer.capacity());
+		buffer.limit(Math.max(count, 0));
+		return count > 0;
+	}
 	
 	/**
-	 * Native read function
+	 * Native bulk read function (blocks until at least one byte is available)
 	 * @param instanceID Pointer of JavaVM instance
-	 * @return Byte that was read or -1
+	 * @param buffer Direct buffer to be filled from its start
+	 * @param max Maximum number of bytes to be read
+	 * @return Number of bytes read or -1 on EOF
 	 */
-	private static native int NReadByte(long instanceID);
+	private static native int NRead(long instanceID, ByteBuffer buffer, int max);
 	
 	/***
-	 * Checks if std::cin has chars available
+	 * Number of bytes std::cin can deliver without blocking
 	 * @param instanceID Pointer of JavaVM instance
-	 * @return True when a char can be read
+	 * @return Available byte count
 	 */
-	private static native boolean NCanRead(long instanceID);
+	private static native int NAvailable(long instanceID);
 }
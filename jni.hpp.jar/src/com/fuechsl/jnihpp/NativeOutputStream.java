@@ -0,0 +1,120 @@
+package com.fuechsl.jnihpp;
+
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.util.Objects;
+
+/***
+ * Buffered output stream that hands whole batches of bytes to C++
+ * @author Ludwig Fuechsl
+ */
+public class NativeOutputStream extends OutputStream {
+	// Don't touch this
+	private final long instanceID;
+	
+	// Target stream
+	private final NativeStreamType type;
+	
+	// Direct buffer that is read by C++ without copying
+	private final ByteBuffer buffer;
+	
+	// Flush on every '\n' (otherwise only on size, explicit flush or shutdown)
+	private final boolean lineFlush;
+	
+	/***
+	 * Constructor
+	 * @param instanceID Pointer to JavaVM
+	 * @param type Stream that is targeted on the C++ side
+	 * @param capacity Size of the batching buffer in bytes
+	 * @param lineFlush True when every newline shall flush the buffer
+	 */
+	public NativeOutputStream(long instanceID, NativeStreamType type, int capacity, boolean lineFlush) {
+		this.instanceID = instanceID;
+		this.type = type;
+		this.buffer = ByteBuffer.allocateDirect(Math.max(capacity, 1));
+		this.lineFlush = lineFlush;
+	}
+	
+	@Override
+	public synchronized void write(int b) {
+		// Make room
+		if(!buffer.hasRemaining())
+			flushBuffer();
+		
+		// Store and flush line
+		buffer.put((byte)b);
+		if(lineFlush && b == '\n')
+			flushBuffer();
+	}
+	
+	@Override
+	public synchronized void write(byte[] b, int off, int len) {
+		Objects.checkFromIndexSize(off, len, b.length);
+		boolean newline = false;
+		
+		while(len > 0) {
+			// Make room
+			if(!buffer.hasRemaining())
+				flushBuffer();
+			
+			// Copy as much as possible
+			int count = Math.min(len, buffer.remaining());
+			if(lineFlush && !newline) {
+				for(int i = off; i < off + count; i++) {
+					if(b[i] == '\n') {
+						newline = true;
+						break;
+					}
+				}
+			}
+			buffer.put(b, off, count);
+			off += count;
+			len -= count;
+		}
+		
+		// Flush the whole batch once
+		if(newline)
+			flushBuffer();
+	}
+	
+	@Override
+	public synchronized void flush() {
+		flushBuffer();
+	}
+	
+	@Override
+	public void close() {
+		flush();
+	}
+	
+	/***
+	 * Hands the buffered bytes to C++ (one native call)
+	 */
+	private void flushBuffer() {
+		int length = buffer.position();
+		if(length > 0) {
+			// Redirect according to stream type
+			if(type == NativeStreamType.OutputStream)
+				NStdOut(instanceID, buffer, length);
+			else if(type == NativeStreamType.ErrorStream)
+				NStdErr(instanceID, buffer, length);
+			
+			buffer.clear();
+		}
+	}
+	
+	/***
+	 * Native std::cout (Can be hooked in a custom jni::JavaVM implementation)
+	 * @param instanceid Pointer of JavaVM instance
+	 * @param buffer Direct buffer holding the UTF-8 encoded bytes
+	 * @param length Number of valid bytes at the start of buffer
+	 */
+	private static native void NStdOut(long instanceid, ByteBuffer buffer, int length);
+	/***
+	 * Native std::cerr (Can be hooked in a custom jni::JavaVM implementation)
+	 * @param instanceid Pointer of JavaVM instance
+	 * @param buffer Direct buffer holding the UTF-8 encoded bytes
+	 * @param length Number of valid bytes at the start of buffer
+	 */
+	private static native void NStdErr(long instanceid, ByteBuffer buffer, int length);
+}
@@ -1,49 +1,27 @@
 package com.fuechsl.jnihpp;
 
-import java.io.OutputStream;
 import java.io.PrintStream;
+import java.nio.charset.StandardCharsets;
 
 /***
  * PrintStream class that will output to a native function
  * @author Ludwig Fuechsl
  */
 public class NativePrintStream extends PrintStream {
-	public NativeStreamType type = NativeStreamType.OutputStream;
-	public long instanceid = 0; 
+	public final NativeStreamType type;
+	public final long instanceid;
 	
 	/***
-	 * Default constructor for streams
-	 * @param out Stream
+	 * Constructor for native streams
+	 * @param instanceid Pointer to JavaVM
+	 * @param type Stream that is targeted on the C++ side
+	 * @param capacity Size of the batching buffer in bytes
+	 * @param lineFlush True when every newline shall flush the buffer
 	 */
-	public NativePrintStream(OutputStream out) {		
-		// Init superclass that will auto flush
-		super(out, true);
+	public NativePrintStream(long instanceid, NativeStreamType type, int capacity, boolean lineFlush) {
+		// Init superclass without auto flush (flushing is done by the native stream)
+		super(new NativeOutputStream(instanceid, type, capacity, lineFlush), false, StandardCharsets.UTF_8);
+		this.type = type;
+		this.instanceid = instanceid;
 	}
-	
-	@Override
-    public void print(String s){
-		// check for nullptr (YES A POINTER IN JAVA)
-		if(instanceid != 0){
-			// Redirect according to stream type
-			if(type == NativeStreamType.OutputStream)
-				NStdOut(instanceid, s);
-			else if(type == NativeStreamType.ErrorStream)
-				NStdErr(instanceid, s);
-		}
-		else {
-			// Use default
-			super.print(s);
-		}
-    }
-	
-	/***
-	 * Native std::cout (Can be hooked in a custom jni::JavaVM implementation)
-	 * @param message Message to print
-	 */
-	private static native void NStdOut(long instanceid, String message);
-	/***
-	 * Native std::cerr (Can be hooked in a custom jni::JavaVM implementation)
-	 * @param message Message to print
-	 */
-	private static native void NStdErr(long instanceid, String message);
 }
@@ -1,33 +1,43 @@
 package com.fuechsl.jnihpp;
 
-import java.io.PrintStream;
-
 /***
  * Class that is responsible for setting up all java sided things
  * @author Ludwig Fuechsl
  */
 public class Setup {
+	// Default size of the stdout / stderr batching buffer
+	public static final int DEFAULT_STREAM_BUFFER = 8192;
+	
 	/***
 	 * Runs the static setup required to hook into the jni.hpp JavaVM
 	 * @param instanceID JavaVM instance id
 	 */
 	public static void RunSetup(long instanceID){
+		// Stream buffering (-Djnihpp.stream.buffer=... / -Djnihpp.stream.lineflush=...)
+		int streamBuffer = Integer.getInteger("jnihpp.stream.buffer", DEFAULT_STREAM_BUFFER);
+		boolean lineFlush = Boolean.parseBoolean(System.getProperty("jnihpp.stream.lineflush", "true"));
+		
 		// Redirect stdout
-		PrintStream defaultOut = System.out;
-		NativePrintStream nativeStdout = new NativePrintStream(defaultOut);
-		nativeStdout.type = NativeStreamType.OutputStream;
-		nativeStdout.instanceid = instanceID;
+		NativePrintStream nativeStdout = new NativePrintStream(instanceID, NativeStreamType.OutputStream, streamBuffer, lineFlush);
 		System.setOut(nativeStdout);
 		
 		// Redirect stderr
-		PrintStream defaultErr = System.err;
-		NativePrintStream nativeStderr = new NativePrintStream(defaultErr);
-		nativeStderr.type = NativeStreamType.ErrorStream;
-		nativeStderr.instanceid = instanceID;
+		NativePrintStream nativeStderr = new NativePrintStream(instanceID, NativeStreamType.ErrorStream, streamBuffer, lineFlush);
 		System.setErr(nativeStderr);
 		
 		// Redirect stdin
 		NativeInputStream nativeStdin = new NativeInputStream(instanceID);
-		System.setIn(nativeStdin);	
+		System.setIn(nativeStdin);
+		
+		// Don't lose buffered output on exit
+		Runtime.getRuntime().addShutdownHook(new Thread(Setup::Flush, "jnihpp-flush"));
+	}
+	
+	/***
+	 * Flushes the buffered stdout and stderr streams to C++
+	 */
+	public static void Flush(){
+		System.out.flush();
+		System.err.flush();
 	}
 }
@@ -1,10 +1,21 @@
 package com.fuechsl.jnihpp.reflection;
 
+import java.io.ByteArrayOutputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.lang.reflect.Constructor;
+import java.lang.reflect.Field;
+import java.lang.reflect.Method;
+
 /***
  * Class that statically reflects a class by its name 
  * @author Ludwig Fuechsl
  */
 public final class ClassReflector {
+	// Export format (must match jni::ReflectedClass)
+	public static final int EXPORT_MAGIC = 0x4A52464C;
+	public static final int EXPORT_VERSION = 1;
 	
 	/***
 	 * Reflect class by its name
@@ -35,4 +46,137 @@ public final class ClassReflector {
 		// Return final result
 		return result;
 	}
+	
+	/***
+	 * Exports the complete metadata of a class with a single call (called from C++)
+	 * @param name Binary or internal name
+	 * @return Packed metadata (see Export(Class)) or null when the class does not exist
+	 */
+	public static byte[] Export(String name) {
+		try {
+			Class<?> cls = com.fuechsl.jnihpp.ClassLoader.LoadClass(name);
+			return cls == null ? null : Export(cls);
+		}
+		catch(LinkageError | SecurityException e) {
+			// Member types that cannot be resolved
+			return null;
+		}
+	}
+	
+	/***
+	 * Exports the complete metadata of a class
+	 * Big endian, strings are u2 length + modified UTF-8 (like in class files):
+	 * u4 magic, u2 version, u4 modifiers, name, super name ("" for none),
+	 * u2 count + interface names, u2 count + fields, u2 count + methods and constructors ("&lt;init&gt;")
+	 * Each field / method is u4 modifiers, name, JNI descriptor
+	 * @param cls Class to be exported
+	 * @return Packed metadata
+	 */
+	public static byte[] Export(Class<?> cls) {
+		ByteArrayOutputStream bytes = new ByteArrayOutputStream(1024);
+		try(DataOutputStream out = new DataOutputStream(bytes)) {
+			out.writeInt(EXPORT_MAGIC);
+			out.writeShort(EXPORT_VERSION);
+			out.writeInt(cls.getModifiers());
+			out.writeUTF(InternalName(cls));
+			out.writeUTF(cls.getSuperclass() == null ? "" : InternalName(cls.getSuperclass()));
+			
+			Class<?>[] interfaces = cls.getInterfaces();
+			out.writeShort(interfaces.length);
+			for(Class<?> i : interfaces) {
+				out.writeUTF(InternalName(i));
+			}
+			
+			Field[] fields = cls.getDeclaredFields();
+			out.writeShort(fields.length);
+			for(Field field : fields) {
+				out.writeInt(field.getModifiers());
+				out.writeUTF(field.getName());
+				out.writeUTF(Descriptor(field.getType()));
+			}
+			
+			Method[] methods = cls.getDeclaredMethods();
+			Constructor<?>[] constructors = cls.getDeclaredConstructors();
+			out.writeShort(methods.length + constructors.length);
+			for(Method method : methods) {
+				out.writeInt(method.getModifiers());
+				out.writeUTF(method.getName());
+				out.writeUTF(Descriptor(method.getParameterTypes(), method.getReturnType()));
+			}
+			for(Constructor<?> constructor : constructors) {
+				out.writeInt(constructor.getModifiers());
+				out.writeUTF("<init>");
+				out.writeUTF(Descriptor(constructor.getParameterTypes(), void.class));
+			}
+		}
+		catch(IOException e) {
+			return null;
+		}
+		return bytes.toByteArray();
+	}
+	
+	/***
+	 * 64 bit FNV-1a hash of the class file (called from C++, key of the on disk reflection cache)
+	 * @param name Binary or internal name
+	 * @return Hash or 0 when the class file cannot be read
+	 */
+	public static long HashClass(String name) {
+		Class<?> cls = com.fuechsl.jnihpp.ClassLoader.LoadClass(name);
+		if(cls == null)
+			return 0;
+		
+		long hash = 0xcbf29ce484222325L;
+		try(InputStream in = cls.getResourceAsStream("/" + InternalName(cls) + ".class")) {
+			if(in == null)
+				return 0;
+			byte[] buffer = new byte[8192];
+			for(int count = in.read(buffer); count >= 0; count = in.read(buffer)) {
+				for(int i = 0; i < count; i++) {
+					hash = (hash ^ (buffer[i] & 0xFF)) * 0x100000001b3L;
+				}
+			}
+		}
+		catch(IOException | SecurityException e) {
+			return 0;
+		}
+		return hash == 0 ? 1 : hash;
+	}
+	
+	/***
+	 * JNI descriptor of a type ("I", "[J", "Ljava/lang/String;")
+	 * @param type Type
+	 * @return Descriptor
+	 */
+	public static String Descriptor(Class<?> type) {
+		if(type.isArray())
+			return type.getName().replace('.', '/');
+		if(type == void.class) return "V";
+		if(type == boolean.class) return "Z";
+		if(type == byte.class) return "B";
+		if(type == char.class) return "C";
+		if(type == short.class) return "S";
+		if(type == int.class) return "I";
+		if(type == long.class) return "J";
+		if(type == float.class) return "F";
+		if(type == double.class) return "D";
+		return "L" + InternalName(type) + ";";
+	}
+	
+	/***
+	 * JNI descriptor of a method ("(ILjava/lang/String;)V")
+	 * @param parameters Parameter types
+	 * @param result Return type
+	 * @return Descriptor
+	 */
+	public static String Descriptor(Class<?>[] parameters, Class<?> result) {
+		StringBuilder descriptor = new StringBuilder("(");
+		for(Class<?> parameter : parameters) {
+			descriptor.append(Descriptor(parameter));
+		}
+		return descriptor.append(')').append(Descriptor(result)).toString();
+	}
+	
+	private static String InternalName(Class<?> cls) {
+		return cls.getName().replace('.', '/');
+	}
 }
@@ -87,16 +87,10 @@ public class ReflectionResult {
 	 * Retrieve the jni signature of the method
 	 * @param index Index of method to be retrieved
 	 * @return Method signature as string or null
-	 * @throws IllegalAccessException 
-	 * @throws IllegalArgumentException 
 	 */
-	public String GetMethodSignature(int index) throws IllegalArgumentException, IllegalAccessException, NoSuchFieldException {
-		// Get field and make accessible
-		Field fd = Method.class.getDeclaredField("signature");
-		fd.setAccessible(true);
-		
-		// Get jni signature
-		return (index >= 0 && index < GetMethodCount() && fd != null ? (String)fd.get(methods[index]) : null);
+	public String GetMethodSignature(int index) {
+		// Built from the public types (no access to private jdk fields)
+		return (index >= 0 && index < GetMethodCount() ? ClassReflector.Descriptor(methods[index].getParameterTypes(), methods[index].getReturnType()) : null);
 	}
 	
 	/***
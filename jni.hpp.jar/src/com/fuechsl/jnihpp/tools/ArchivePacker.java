@@ -0,0 +1,165 @@
+package com.fuechsl.jnihpp.tools;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.util.ArrayList;
+import java.util.Enumeration;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.stream.Stream;
+import java.util.zip.ZipEntry;
+import java.util.zip.ZipFile;
+
+/***
+ * Offline packer for the archives read by jni::ClassArchive
+ * Usage: java -cp jni.hpp.jar com.fuechsl.jnihpp.tools.ArchivePacker output.jpa (folder|jar)...
+ * @author Ludwig Fuechsl
+ */
+public final class ArchivePacker {
+	// Format constants (must match jni::ClassArchive)
+	private static final byte[] MAGIC = "JNIHPPAR".getBytes(StandardCharsets.US_ASCII);
+	private static final int VERSION = 1;
+	private static final int HEADER_SIZE = 32;
+	private static final int ENTRY_SIZE = 32;
+	
+	/***
+	 * Packed entry
+	 */
+	private static final class Entry {
+		byte[] name;
+		byte[] data;
+		long hash;
+		long nameOffset;
+		long dataOffset;
+	}
+	
+	/***
+	 * Command line entry point
+	 * @param args Output file followed by input folders and jars
+	 */
+	public static void main(String[] args) throws IOException {
+		if(args.length < 2) {
+			System.err.println("Usage: ArchivePacker <output> <folder|jar>...");
+			System.exit(1);
+		}
+		
+		// First occurrence of a path wins (same as classpath order)
+		Map<String, byte[]> files = new LinkedHashMap<>();
+		for(int i = 1; i < args.length; i++) {
+			Path input = Paths.get(args[i]);
+			if(Files.isDirectory(input))
+				AddFolder(files, input);
+			else
+				AddJar(files, input);
+		}
+		
+		try(OutputStream out = Files.newOutputStream(Paths.get(args[0]))) {
+			Pack(files, out);
+		}
+		System.out.println("Packed " + files.size() + " entries into " + args[0]);
+	}
+	
+	/***
+	 * Writes an archive
+	 * @param files Resource path to content map
+	 * @param out Target stream
+	 */
+	public static void Pack(Map<String, byte[]> files, OutputStream out) throws IOException {
+		// Sort by hash so the entry table doubles as a sorted index
+		List<Entry> entries = new ArrayList<>();
+		for(Map.Entry<String, byte[]> file : files.entrySet()) {
+			Entry entry = new Entry();
+			entry.name = file.getKey().getBytes(StandardCharsets.UTF_8);
+			entry.data = file.getValue();
+			entry.hash = Hash(entry.name);
+			entries.add(entry);
+		}
+		entries.sort((a, b) -> Long.compareUnsigned(a.hash, b.hash));
+		
+		// Layout: header, entry table, names, data (all 8 byte aligned)
+		long offset = HEADER_SIZE + (long)ENTRY_SIZE * entries.size();
+		for(Entry entry : entries) {
+			entry.nameOffset = offset;
+			offset = Align(offset + entry.name.length);
+		}
+		for(Entry entry : entries) {
+			entry.dataOffset = offset;
+			offset = Align(offset + entry.data.length);
+		}
+		
+		// Header and table
+		ByteBuffer head = ByteBuffer.allocate(HEADER_SIZE + ENTRY_SIZE * entries.size()).order(ByteOrder.LITTLE_ENDIAN);
+		head.put(MAGIC).putInt(VERSION).putInt(entries.size()).putLong(HEADER_SIZE).putLong(0);
+		for(Entry entry : entries) {
+			head.putLong(entry.hash).putLong(entry.nameOffset).putLong(entry.dataOffset).putInt(entry.name.length).putInt(entry.data.length);
+		}
+		out.write(head.array());
+		
+		// Blobs
+		byte[] padding = new byte[8];
+		for(Entry entry : entries) {
+			out.write(entry.name);
+			out.write(padding, 0, (int)(Align(entry.name.length) - entry.name.length));
+		}
+		for(Entry entry : entries) {
+			out.write(entry.data);
+			out.write(padding, 0, (int)(Align(entry.data.length) - entry.data.length));
+		}
+	}
+	
+	/***
+	 * 64 bit FNV-1a (must match jni::ClassArchive)
+	 * @param data Bytes to hash
+	 * @return Hash value
+	 */
+	public static long Hash(byte[] data) {
+		long hash = 0xcbf29ce484222325L;
+		for(byte b : data) {
+			hash ^= (b & 0xFF);
+			hash *= 0x100000001b3L;
+		}
+		return hash;
+	}
+	
+	private static long Align(long value) {
+		return (value + 7) & ~7L;
+	}
+	
+	private static void AddFolder(Map<String, byte[]> files, Path folder) throws IOException {
+		List<Path> paths = new ArrayList<>();
+		try(Stream<Path> walk = Files.walk(folder)) {
+			walk.filter(Files::isRegularFile).sorted().forEach(paths::add);
+		}
+		for(Path path : paths) {
+			String name = folder.relativize(path).toString().replace('\\', '/');
+			if(!files.containsKey(name))
+				files.put(name, Files.readAllBytes(path));
+		}
+	}
+	
+	private static void AddJar(Map<String, byte[]> files, Path jar) throws IOException {
+		try(ZipFile zip = new ZipFile(jar.toFile())) {
+			Enumeration<? extends ZipEntry> it = zip.entries();
+			while(it.hasMoreElements()) {
+				ZipEntry entry = it.nextElement();
+				if(entry.isDirectory() || files.containsKey(entry.getName()))
+					continue;
+				
+				try(InputStream in = zip.getInputStream(entry)) {
+					ByteArrayOutputStream content = new ByteArrayOutputStream();
+					in.transferTo(content);
+					files.put(entry.getName(), content.toByteArray());
+				}
+			}
+		}
+	}
+}
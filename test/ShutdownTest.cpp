@@ -0,0 +1,94 @@
+// Shutdown test: StopVM must not hang while a non daemon thread is still attached
+//
+//   ShutdownTest <jar folder>
+//
+// The worker holds a ThreadScope (non daemon) and leaves it while StopVM waits in DestroyJavaVM
+#include <jni.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+class TestVM : public jni::JavaVM
+{
+    public:
+        TestVM(std::filesystem::path JarFolder) :
+            JarFolder(std::move(JarFolder))
+        {}
+
+    protected:
+        void SetupVM(jni::VMArguments& Args) override
+        {
+            Args.SetJNIVersion(JNI_VERSION_10);
+            Args.AddClasspathJarFolder(JarFolder);
+        }
+
+    private:
+        std::filesystem::path JarFolder;
+};
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <jar folder>" << std::endl;
+        return 1;
+    }
+
+    TestVM VM(argv[1]);
+    if (!VM.StartVM())
+    {
+        std::cout << "StartVM failed" << std::endl;
+        return 1;
+    }
+
+    // Non daemon worker (DestroyJavaVM waits for it)
+    std::atomic<bool> Attached = false;
+    std::atomic<bool> Stopping = false;
+    std::thread Worker([&]()
+    {
+        jni::ThreadScope Scope(VM, false, "ShutdownTest.Worker");
+        Attached = (bool)Scope;
+        while (!Stopping)
+        {
+            std::this_thread::yield();
+        }
+
+        // Give StopVM time to reach DestroyJavaVM (asking for the env must not lose the attachment)
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        VM.GetEnv();
+    });
+    while (!Attached)
+    {
+        std::this_thread::yield();
+    }
+
+    // Watchdog (a lost detach blocks DestroyJavaVM forever)
+    std::atomic<bool> Stopped = false;
+    std::thread Watchdog([&]()
+    {
+        for (int i = 0; i < 200 && !Stopped; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (!Stopped)
+        {
+            std::cout << "StopVM did not return (non daemon thread was not detached)" << std::endl;
+            std::_Exit(1);
+        }
+    });
+
+    Stopping = true;
+    VM.StopVM();
+    Stopped = true;
+    Worker.join();
+    Watchdog.join();
+
+    if (VM.IsRunning())
+    {
+        std::cout << "Vm state after StopVM is wrong" << std::endl;
+        return 1;
+    }
+    std::cout << "StopVM returned with a non daemon thread attached" << std::endl;
+    return 0;
+}